@@ -5,10 +5,10 @@
 #include "mmu.h"
 
 #include <cstdint>
-#include <cmath>
+#include <array>
 
-#define SAMPLE_RATE 44100.0f
-#define SAMPLE_FREQ 4194304.0f / SAMPLE_RATE
+#define SAMPLE_RATE 44100
+#define SAMPLE_LEVEL 256 // output step for one step of a channel's 4-bit DAC
 
 namespace GB2040::Core {
 
@@ -18,10 +18,19 @@ class APU {
 public:
     APU(Console&);
 
-    void tick(size_t);
+    void sync(void);
+    void flush(void);
     void setEnabled(bool);
+    void setSampleRate(uint32_t);
 
 private:
+    void tick(size_t);
+    void run(uint32_t);
+    void stepChannels(uint32_t);
+    void stepFrameSequencer(void);
+    void updateOutput(void);
+    void updateGains(void);
+    void readOut(void);
     StereoSample mix(uint8_t, uint8_t, uint8_t, uint8_t);
 
     friend MMU; // IO ports
@@ -33,15 +42,27 @@ private:
 
     uint8_t pan = 0;
 
+    // NR50 volume v scales by v/7, in output units per DAC step
+    static constexpr std::array<int16_t, 8> volumeGains { 0, 37, 73, 110, 146, 183, 219, SAMPLE_LEVEL };
+
+    // what each channel's DAC step is worth on each side with the current NR50/NR51
+    int16_t gains[2][4] {};
+
     Console& console;
     PulseChannel pulse1, pulse2;
     WaveChannel wave;
     NoiseChannel noise;
 
+    uint64_t lastSync = 0; // scheduler timestamp the channels have been stepped up to
+
     uint8_t divApu = 0;
     uint32_t divApuTimer = 8192;
 
-    float sampleTimer = SAMPLE_FREQ;
+    BlepBuffer blep { SAMPLE_RATE };
+    uint32_t frameTime = 0; // cycles since the buffer's frame was last ended
+    StereoSample level { 0, 0 }; // mixed output as of frameTime
+
+    StereoSample output[BLEP_BUFFER_SIZE];
 };
 
 } // namespace GB2040::Core
\ No newline at end of file
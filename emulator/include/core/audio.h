@@ -1,12 +1,48 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+
+#define BLEP_WIDTH 16 // taps per step, output lags by half of this
+#define BLEP_PHASE_BITS 5 // sub-sample positions a step can land on
+#define BLEP_PHASES (1 << BLEP_PHASE_BITS)
+#define BLEP_KERNEL_BITS 15 // each phase's taps add up to 1 << this
+#define BLEP_CLOCK_SHIFT 22 // clocks come in at exactly 2^22 Hz, so positions are kept in that fixed point
+#define BLEP_BUFFER_SIZE 2048 // samples that can build up before they have to be read
 
 namespace GB2040::Core
 {
 
 struct StereoSample {
-    uint8_t l, r;
+    int16_t l, r;
+};
+
+// band-limited step synthesis: level changes go in at the clock they happen on, output-rate samples come out
+// all integer, so it costs the same on cores without an FPU
+class BlepBuffer {
+public:
+    BlepBuffer(uint32_t);
+
+    void setRate(uint32_t);
+    uint32_t getMaxClocks(void);
+
+    void addDelta(uint32_t, int, int);
+    void endFrame(uint32_t);
+
+    size_t read(StereoSample*, size_t);
+    void clear(void);
+private:
+    uint32_t rate; // samples per second, which is also samples per 2^22 clocks
+    uint32_t offset = 0; // where clock 0 of the current frame lands past the available samples, in 2^-22 samples
+
+    size_t available = 0;
+
+    // differences between samples, integrated as they're read out (free to wrap, the integral never does)
+    uint32_t left[BLEP_BUFFER_SIZE + BLEP_WIDTH];
+    uint32_t right[BLEP_BUFFER_SIZE + BLEP_WIDTH];
+
+    int32_t leftSum = 0;
+    int32_t rightSum = 0;
 };
 
-} // namespace GB2040::Core
+} // namespace GB2040::Core
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#define BLOCK_CACHE_SIZE 1024 // must be a power of 2
+#define MAX_BLOCK_INSTRS 16
+
+namespace GB2040::Core
+{
+
+class CPU; // forward declaration for OpcodeImpl
+
+typedef uint8_t (CPU::*OpcodeImpl)();
+
+struct BlockInstr {
+    OpcodeImpl impl;
+    uint8_t length; // opcode bytes, 2 with the CB prefix
+    uint8_t operands[2];
+};
+
+// straight-line run of ROM code, ending at the first jump, call, return or HALT/STOP
+struct Block {
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    uint32_t tag = EMPTY; // ROM bank << 16 | start address
+    uint8_t count = 0;
+    BlockInstr instrs[MAX_BLOCK_INSTRS];
+};
+
+} // namespace GB2040::Core
@@ -12,7 +12,8 @@ class APU;
 
 class IChannel {
 public:
-    virtual void tick(void) = 0;
+    virtual void advance(uint32_t) = 0; // step the waveform forward by a number of cycles
+    virtual uint32_t nextEdge(void) = 0; // cycles until out() could change, UINT32_MAX if it can't
     virtual void lenTick(void) = 0;
     virtual uint8_t readReg(uint8_t) = 0;
     virtual void writeReg(uint8_t, uint8_t) = 0;
@@ -26,7 +27,8 @@ private:
 
 class PulseChannel : public IChannel {
 public:
-    void tick(void) override;
+    void advance(uint32_t) override;
+    uint32_t nextEdge(void) override;
     void lenTick(void) override;
     uint8_t readReg(uint8_t) override;
     void writeReg(uint8_t, uint8_t) override;
@@ -76,7 +78,8 @@ private:
 
 class WaveChannel : public IChannel {
 public:
-    void tick(void) override;
+    void advance(uint32_t) override;
+    uint32_t nextEdge(void) override;
     void lenTick(void) override;
     uint8_t readReg(uint8_t) override;
     void writeReg(uint8_t, uint8_t) override;
@@ -110,7 +113,8 @@ private:
 
 class NoiseChannel : public IChannel {
 public:
-    void tick(void) override;
+    void advance(uint32_t) override;
+    uint32_t nextEdge(void) override;
     void lenTick(void) override;
     uint8_t readReg(uint8_t) override;
     void writeReg(uint8_t, uint8_t) override;
@@ -124,6 +128,7 @@ private:
     static constexpr std::array<uint8_t, 8> divisors { 8, 16, 32, 48, 64, 80, 96, 112 };
 
     void init(void) override;
+    uint32_t getPeriod(void);
 
     friend MMU;
 
@@ -138,7 +143,7 @@ private:
     uint8_t clockDiv = 0x00;
 
     uint8_t volume = 0x00;
-    uint16_t timer = 0x00;
+    uint32_t timer = 0x00; // wide enough for the longest divisor and shift
     uint16_t lengthTimer = 0x00;
     uint16_t envelopeTimer = 0x00;
     uint16_t lfsr = 0x00;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "scheduler.h"
 #include "cpu.h"
 #include "mmu.h"
 #include "mbc.h"
@@ -72,6 +73,7 @@ public:
     GBMode mode = GBMode::DMG;
     CartridgeHeader header;
 
+    Scheduler scheduler;
     CPU cpu;
     IMBC* mbc;
     MMU mmu;
@@ -106,6 +108,7 @@ public:
 
     size_t tick(void);
     size_t doTicks(size_t);
+    void runEvents(void);
     void run(void);
     void requestInterrupt(Interrupt);
     void pressButton(Button);
@@ -1,14 +1,18 @@
 #pragma once
 
+#include "core/icache.h"
+#include "core/blocks.h"
+
 #include <cstdint>
 
 #include <fstream>
 
+#define IDLE_LOOP_MAX_BYTES 16 // longest backward branch considered a polling loop
+
 namespace GB2040::Core
 {
 
 class Console; // forward declaration
-class CPU; // forward declaration for OpcodeImpl
 
 enum FlagMask : uint8_t {
     CF = 4,
@@ -17,34 +21,53 @@ enum FlagMask : uint8_t {
     ZF = 7
 };
 
-typedef uint8_t (CPU::*OpcodeImpl)();
-
-struct RegisterPair {
-    uint8_t hi;
-    uint8_t lo;
+union RegisterPair {
+    uint16_t val;
+    struct {
+        uint8_t lo; // low byte first, both targets (x86 and the RP2040) are little-endian
+        uint8_t hi;
+    };
 
     uint16_t get() {
-        return (hi << 8) | lo;
+        return val;
     }
 
-    void set(uint16_t val) {
-        lo = val & 0xFF;
-        hi = val >> 8;
+    void set(uint16_t v) {
+        val = v;
     }
 };
 
+struct IdleLoop {
+    bool active = false;
+
+    uint16_t head = 0; // branch target
+    uint16_t end = 0; // address after the branch
+
+    uint64_t start = 0; // timestamp of the branch that began the watched iteration
+    uint32_t writeCount = 0;
+
+    // state at the top of the watched iteration
+    uint16_t af = 0, bc = 0, de = 0, hl = 0, sp = 0;
+    bool ime = false, eiPending = false;
+};
+
 class CPU {
 public:
     CPU(Console& console);
     size_t tick(void);
     char* getDebug(void);
     void yieldCycles(size_t);
+#ifdef BLOCK_CORE
+    bool runBlock(void);
+#endif
 
     bool ime = false;
     uint8_t ie = 0;
     uint8_t intFlag = 0;
     bool stopped = false;
 
+    InstructionCache icache;
+
 private:
     Console& console;
 
@@ -55,8 +78,15 @@ private:
 
     size_t forceCycles = 0;
 
+    const uint8_t* operands = nullptr; // immediates of the cached instruction being executed
+
     uint8_t execute(uint8_t);
 
+#ifdef BLOCK_CORE
+    Block* getBlock(uint16_t);
+    Block blocks[BLOCK_CACHE_SIZE];
+#endif
+
     // stack helpers
     void push(uint16_t);
     uint16_t pop(void);
@@ -65,9 +95,30 @@ private:
     uint16_t fetch16(void);
 
     bool checkInterrupts(void);
+    size_t haltCycles(void);
+
+    IdleLoop idleLoop;
+    void detectIdleLoop(uint16_t, uint8_t);
+    void stopIdleLoop(void);
+
+    // flags are kept as the inputs of the last operation that set them and only
+    // worked out when something reads them (AF.lo is unused, see getF)
+    uint16_t flagZC = 1; // Z is set when the low byte is 0, C is bit 8
+    uint8_t flagHA = 0, flagHB = 0; // H is the carry (or borrow) out of bit 3 of flagHA + flagHB (or flagHA - flagHB)
+    bool flagN = false;
+
+    bool getFlag(FlagMask flag) {
+        switch (flag) {
+            case ZF: return (flagZC & 0xFF) == 0;
+            case NF: return flagN;
+            case HF: return ((flagN ? flagHA - flagHB : flagHA + flagHB) & 0x10) != 0;
+            default: return (flagZC >> 8) & 1;
+        }
+    }
 
     void setFlag(FlagMask, bool);
-    bool getFlag(FlagMask);
+    uint8_t getF(void);
+    void setF(uint8_t);
 
     void initInstrTable(void);
     void initCbInstrTable(void);
@@ -6,7 +6,38 @@
 namespace GB2040::Core
 {
 
-typedef uint16_t Colour;
+typedef uint16_t Colour; // RGB565, in host byte order unless RGB565_BIG_ENDIAN is set
+
+// the 4 DMG shades, lightest first
+#ifdef RGB565_BIG_ENDIAN
+static constexpr Colour dmgLut[4] { // bytes already in the order SPI panels take them
+    0xFFFF,
+    0x55AD,
+    0xAA52,
+    0x0000
+};
+#else
+static constexpr Colour dmgLut[4] {
+    0xFFFF,
+    0xAD55,
+    0x52AA,
+    0x0000
+};
+#endif
+
+#ifdef INDEXED_FRAMEBUFFER
+typedef uint8_t Pixel; // a shade, stored 4 to a byte and only turned into a Colour when read back
+#else
+typedef Colour Pixel;
+#endif
+
+static inline Pixel shadePixel(uint8_t shade) {
+#ifdef INDEXED_FRAMEBUFFER
+    return shade;
+#else
+    return dmgLut[shade];
+#endif
+}
 
 #define GB_WIDTH  160
 #define GB_HEIGHT 144
@@ -17,9 +48,44 @@ public:
 
     void clear(void);
 
-    void setPixel(unsigned int, unsigned int, Colour);
-    Colour getPixel(unsigned int, unsigned int);
-    Colour* data(void);
+    void setLine(unsigned int, const Pixel*);
+
+#ifdef INDEXED_FRAMEBUFFER
+    uint8_t getShade(unsigned int x, unsigned int y) {
+        unsigned int idx = y * w + x;
+        return (fb[idx / 4] >> ((idx % 4) * 2)) & 0x03;
+    }
+
+    void setPixel(unsigned int x, unsigned int y, Pixel pixel) {
+        unsigned int idx = y * w + x;
+        uint8_t shift = (idx % 4) * 2;
+        fb[idx / 4] = (fb[idx / 4] & ~(0x03 << shift)) | (pixel << shift);
+    }
+
+    Colour getPixel(unsigned int x, unsigned int y) {
+        return dmgLut[getShade(x, y)];
+    }
+
+    uint8_t* data(void) { // 2 bits per pixel, leftmost pixel in the low bits
+        return fb.data();
+    }
+#else
+    Colour* getRow(unsigned int y) {
+        return fb.data() + y * w;
+    }
+
+    void setPixel(unsigned int x, unsigned int y, Pixel pixel) {
+        getRow(y)[x] = pixel;
+    }
+
+    Colour getPixel(unsigned int x, unsigned int y) {
+        return getRow(y)[x];
+    }
+
+    Colour* data(void) {
+        return fb.data();
+    }
+#endif
     size_t size(void);
 
     unsigned int getWidth(void);
@@ -28,7 +94,11 @@ private:
     unsigned int w;
     unsigned int h;
 
+#ifdef INDEXED_FRAMEBUFFER
+    std::vector<uint8_t> fb;
+#else
     std::vector<Colour> fb;
+#endif
 };
 
 } // namespace GB2040::Core
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#define ICACHE_SIZE 2048 // decoded instructions, must be a power of 2
+
+namespace GB2040::Core
+{
+
+class Console;
+
+struct DecodedInstr {
+    uint32_t tag; // ROM bank << 16 | address
+    uint8_t bytes[3]; // opcode and immediates
+};
+
+class InstructionCache {
+public:
+    InstructionCache(Console&);
+
+    const uint8_t* fetch(uint16_t);
+    void invalidate(uint16_t);
+
+    bool hasCode(uint16_t addr) {
+        return codePages[addr >> 8];
+    }
+
+    static uint8_t getLength(uint8_t);
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    Console& console;
+
+    void markCode(uint8_t);
+
+    DecodedInstr entries[ICACHE_SIZE];
+    bool codePages[256]; // RAM pages holding cached code, writes there have to invalidate
+};
+
+} // namespace GB2040::Core
@@ -63,6 +63,16 @@ public:
     };
 
     virtual void save(void) {  };
+
+    // ROM bank currently visible at $0000-$3FFF and $4000-$7FFF
+    uint16_t romBanks[2] = { 0, 1 };
+
+    // host memory behind those banks and $A000-$BFFF, nullptr where accesses
+    // have to go through read8/write8 (unmappable source, RAM disabled, RTC...)
+    const uint8_t* romBankData[2] = { nullptr, nullptr };
+    uint8_t* ramBankData = nullptr;
+protected:
+    void mapBanks(ROMSource*, RAMSource*, uint32_t, bool);
 };
 
 class MBC1 : public IMBC {
@@ -74,6 +84,9 @@ public:
 
     void save(void) override;
 private:
+    void updateRomBanks(void);
+    void remap(void);
+
     Console& console;
     CartridgeHeader& header;
 
@@ -98,6 +111,8 @@ public:
 
     void save(void) override;
 private:
+    void remap(void);
+
     Console& console;
     CartType cartType;
 
@@ -118,6 +133,8 @@ public:
 
     void save(void) override;
 private:
+    void remap(void);
+
     void tickRTC(void);
     RTC parseRTC(void);
 
@@ -150,6 +167,8 @@ public:
 
     void save(void) override;
 private:
+    void remap(void);
+
     Console& console;
     CartridgeHeader& header;
     ROMSource* romSource;
@@ -4,6 +4,7 @@
 
 #define WRAM_SIZE 0x2000 // $C000-$DFFF
 #define HRAM_SIZE 0x7F // $FF80-$FFFE
+#define PAGE_COUNT 0x100 // 256-byte pages
 
 namespace GB2040::Core
 {
@@ -14,19 +15,61 @@ class MMU {
 public:
     MMU(Console&);
 
-    uint8_t read8(uint16_t);
+    uint8_t read8(uint16_t addr) {
+        const uint8_t* page = readPages[addr >> 8];
+        if (page) return page[addr & 0xFF]; // plain memory
+
+        return readSlow(addr);
+    }
     uint16_t read16(uint16_t);
 
-    void write8(uint16_t, uint8_t);
+    void write8(uint16_t addr, uint8_t val) {
+        writeCount++;
+
+        uint8_t* page = writePages[addr >> 8];
+        if (page) {
+            page[addr & 0xFF] = val;
+            return;
+        }
+
+        writeSlow(addr, val);
+    }
     void write16(uint16_t, uint16_t);
 
     uint8_t readIo(uint16_t);
     void writeIo(uint16_t, uint8_t);
+
+    bool isBootRomMapped(void) {
+        return bootRomMapped;
+    }
+
+    // idle loop detection
+    void watch(bool);
+    uint64_t getWatchedDeadline(void);
+
+    uint32_t writeCount = 0;
+
+    void protectPage(uint8_t);
+    void mapCartridge(void);
 private:
     Console& console;
 
     bool bootRomMapped = true;
 
+    // host memory behind each page, nullptr where accesses need a handler (I/O, OAM, MBC registers...)
+    const uint8_t* readPages[PAGE_COUNT];
+    uint8_t* writePages[PAGE_COUNT];
+
+    uint8_t readSlow(uint16_t);
+    void writeSlow(uint16_t, uint8_t);
+
+    void noteRead(uint16_t);
+    uint64_t getNextChange(uint16_t);
+
+    // while watching, the earliest time anything read could have changed
+    bool watching = false;
+    uint64_t watchedDeadline = 0;
+
     uint8_t internalWram[WRAM_SIZE];
     uint8_t hram[HRAM_SIZE];
 };
@@ -9,6 +9,8 @@
 
 #define OAM_SIZE       160
 
+#define TILE_COUNT     384 // tiles in $8000-$97FF
+
 namespace GB2040::Core
 {
 
@@ -29,8 +31,15 @@ class PPU {
 public:
     PPU(Console& console);
 
-    void tick(size_t);
-    void renderScanline(void);
+    void tick(void);
+    void sync(void);
+    void scheduleUpdate(void);
+    uint64_t getNextLyChange(void);
+    uint64_t getNextStatChange(void);
+    void renderScanline(uint8_t);
+    void renderPending(void);
+    void prepareRegisterWrite(void);
+    void setRenderInterval(uint32_t);
 
     uint8_t readVram(uint16_t);
     void writeVram(uint16_t, uint8_t);
@@ -46,19 +55,27 @@ public:
 
     uint8_t readStat(void);
 private:
-    static constexpr Colour dmgLut[4] {
-        0xFFFF,
-        0x55AD,
-        0xAA52,
-        0x0000
-    };
-
     uint16_t getMapBase(PPULayer);
-
-    void renderScanlineLayer(PPULayer);
-    void renderScanlineObjects(void);
-    void renderScanlinePixel(PPULayer, uint8_t x);
-    void sortSprites(Sprite*, size_t);
+    uint32_t getModeCycles(void);
+    uint32_t getFramePosition(void);
+    uint32_t getTransferCycles(void);
+    uint32_t getObjectPenalty(const Sprite&);
+    uint8_t getTransferX(void);
+    void updateStat(void);
+    void schedule(void);
+
+    void renderScanlineLayer(PPULayer, uint8_t);
+    void renderScanlineObjects(uint8_t);
+    void renderSpan(uint8_t, uint8_t, uint8_t);
+    bool isWindowVisible(uint8_t);
+    uint8_t selectLineSprites(uint8_t, Sprite*);
+    uint64_t getObjectRow(const Sprite&, uint8_t);
+    uint16_t getTileRowAddr(uint8_t, uint8_t);
+    uint64_t getTileRow(uint16_t);
+#ifdef TILE_CACHE
+    void decodeTile(uint16_t);
+#endif
+    void buildObjectLists(void);
 
     void hBlank(void);
     void vBlank(void);
@@ -80,9 +97,30 @@ private:
 
     PPUMode mode = PPUMode::HBLANK;
     uint32_t modeClock = 0;
-
-    Sprite sprites[40];
-
+    uint64_t lastSync = 0; // scheduler timestamp modeClock is valid for
+    uint32_t transferCycles = 172; // mode 3 length of the current line, HBlank gets the rest
+
+    // lines are drawn when something they depend on is about to change, or at VBlank
+    uint8_t transferredLines = 0; // lines of this frame that have been through pixel transfer
+    uint8_t renderedLines = 0; // ...and of those, how many are in the framebuffer
+
+    // a register written during mode 3 splits the line, the part already pushed to the LCD keeps the old value
+    uint8_t splitX = 0; // pixels of the current line drawn by renderSpan, 0 if it isn't split
+    bool splitWindow = false; // whether any of them came from the window
+
+    // frame skipping, timing and interrupts carry on as normal
+    uint32_t renderInterval = 1; // draw every Nth frame, 0 for none at all
+    uint32_t frameCount = 0;
+    bool renderFrame = true; // whether the frame in progress gets drawn
+
+    // the objects on each line in drawing priority order (X, then OAM index), as OAM indices
+    // rebuilt from OAM only after a Y/X byte, a DMA or the object height has changed
+    uint8_t lineObjects[GB_HEIGHT][10];
+    uint8_t lineObjectCount[GB_HEIGHT];
+    bool objectListsDirty = true;
+
+    Pixel bgPalette[4]; // BGP applied, rebuilt every line
+    Pixel linePixels[GB_WIDTH]; // the line being drawn, handed to the framebuffer once it's done
     uint8_t bgLineIndices[GB_WIDTH];
     bool objectPixelsDrawn[GB_WIDTH];
 
@@ -107,6 +145,12 @@ private:
 
     uint8_t vram[VRAM_SIZE];
     uint8_t oam[OAM_SIZE];
+
+#ifdef TILE_CACHE
+    // tile rows as returned by getTileRow, re-decoded on first use after a VRAM write
+    uint64_t tileRows[TILE_COUNT][8];
+    bool tileDirty[TILE_COUNT];
+#endif
 };
 
 } // namespace GB2040::Core
\ No newline at end of file
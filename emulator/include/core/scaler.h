@@ -0,0 +1,33 @@
+#pragma once
+
+#include "core/graphics.h"
+
+#include <cstdint>
+
+namespace GB2040::Core
+{
+
+enum class ScaleFilter : uint8_t { NEAREST, SCALE2X, SCALE3X, XBR };
+
+class Scaler {
+public:
+    Scaler(ScaleFilter, unsigned int);
+
+    static bool supports(ScaleFilter, unsigned int);
+
+    ScaleFilter getFilter(void);
+    unsigned int getFactor(void);
+
+    void scale(Framebuffer&, Colour*, unsigned int, unsigned int, unsigned int);
+private:
+    ScaleFilter filter;
+    unsigned int factor;
+
+    void scaleNearest(Framebuffer&, Colour*, unsigned int, unsigned int, unsigned int);
+    void scaleScale2x(Framebuffer&, Colour*, unsigned int, unsigned int, unsigned int);
+    void scaleScale4x(Framebuffer&, Colour*, unsigned int, unsigned int, unsigned int);
+    void scaleScale3x(Framebuffer&, Colour*, unsigned int, unsigned int, unsigned int);
+    void scaleXbr(Framebuffer&, Colour*, unsigned int, unsigned int, unsigned int);
+};
+
+} // namespace GB2040::Core
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace GB2040::Core
+{
+
+// every source of timed work registers its next deadline in its own slot
+enum class Event : uint8_t {
+    PPU,            // next PPU transition that can raise an interrupt (or a forced STAT re-evaluation)
+    TIMER_OVERFLOW, // TIMA wraps
+    TIMER_RELOAD,   // TMA reload + interrupt, one instruction after the overflow
+    SLICE_END,      // end of the current Console::doTicks slice
+
+    COUNT
+};
+
+class Scheduler {
+public:
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    Scheduler(void);
+
+    uint64_t now = 0; // T-cycles since power on
+
+    void schedule(Event, uint64_t);
+    void cancel(Event);
+    bool popDue(Event&);
+
+    uint64_t getDeadline(Event event) {
+        return deadlines[static_cast<size_t>(event)];
+    }
+
+    uint64_t nextDeadline(void) {
+        return next;
+    }
+private:
+    void updateNext(void);
+
+    uint64_t deadlines[static_cast<size_t>(Event::COUNT)];
+    uint64_t next = NEVER; // cached earliest deadline, checked after every instruction
+};
+
+} // namespace GB2040::Core
@@ -17,12 +17,19 @@ public:
     uint8_t tac = 0;
     uint8_t tma = 0;
 
-    void incTimers(size_t);
+    void sync(void);
+    void schedule(void);
+    void reload(void);
     void resetSysCounter(void);
     uint8_t getDiv(void);
+    uint64_t getNextDivChange(void);
+    uint64_t getNextTimaChange(void);
 private:
+
     Console& console;
 
+    uint64_t lastSync = 0; // scheduler timestamp the counters are valid for
+
     uint16_t sysCounter = 0;
     uint16_t timaCounter = 0;
 
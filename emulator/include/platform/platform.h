@@ -18,6 +18,9 @@ public:
 
     virtual void read8(uint32_t, uint8_t*, size_t) = 0;
     virtual size_t size(void) = 0;
+
+    // the whole image if it sits contiguously in memory, so the core can map it directly
+    virtual uint8_t* data(void) { return nullptr; }
 };
 
 class RAMSource : public ROMSource {
@@ -38,6 +41,7 @@ public:
     virtual GB2040::Core::Framebuffer*& getBackBuffer(void) { return back; }
     virtual void draw(void) = 0;
     virtual void pushSamples(GB2040::Core::StereoSample*, size_t) = 0;
+    virtual bool waitForAudio(void) { return false; } // block until the audio device wants another frame, false to pace off the wall clock instead
     virtual ROMSource* selectROM(void) = 0;
     virtual RAMSource* getSave(size_t) = 0;
     virtual void saveData(RAMSource*) = 0;
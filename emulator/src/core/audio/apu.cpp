@@ -3,18 +3,18 @@
 #include "core/console.h"
 
 #include <cstdint>
-#include <cmath>
 #include <cstring>
 #include <algorithm>
 
 namespace GB2040::Core
 {
 
+static_assert(GB_CLOCK_SPEED == 1 << BLEP_CLOCK_SHIFT, "the BLEP buffer's fixed point assumes a 2^22 Hz clock");
+
 APU::APU(Console& console) : 
 console(console), 
 divApu(0), 
 divApuTimer(8192), 
-sampleTimer(SAMPLE_FREQ),
 lVolume(7),
 rVolume(7),
 pan(0),
@@ -22,53 +22,112 @@ enabled(false) {
     setEnabled(false);
 };
 
+void APU::sync(void) {
+    // the APU stays dormant until something observes it, then catches up in one go
+    uint64_t now = console.scheduler.now;
+    tick(now - lastSync);
+    lastSync = now;
+}
+
 void APU::tick(size_t cycles) {
-    if (!enabled) return;
+    while (cycles > 0) {
+        // the buffer only has room for so much time before it has to be read out
+        uint32_t chunk = std::min<size_t>(cycles, blep.getMaxClocks());
+        cycles -= chunk;
+
+        run(chunk);
+
+        blep.endFrame(frameTime);
+        frameTime = 0;
+
+        if (cycles > 0) readOut(); // full, can't wait for the end of the frame
+    }
+}
+
+void APU::run(uint32_t cycles) {
+    updateOutput(); // pick up whatever register writes happened since the last sync
+
+    if (!enabled) {
+        frameTime += cycles;
+        return;
+    }
 
     while (cycles > 0) {
-        cycles--;
-        divApuTimer--;
-        sampleTimer--;
-
-        if (divApuTimer <= 0) {
-            divApuTimer = 8192;
-            switch (divApu) {
-                case 2:
-                case 6: pulse1.sweepTick(); break;
-                case 0:
-                case 4:
-                    pulse1.lenTick();
-                    pulse2.lenTick();
-                    wave.lenTick();
-                    noise.lenTick();
-                    break;
-                case 7:
-                    pulse1.envTick();
-                    pulse2.envTick();
-                    noise.envTick();
-                    break;
-            }
-
-            divApu++;
-            if (divApu >= 8) divApu = 0;
-        }
-
-        pulse1.tick();
-        pulse2.tick();
-        wave.tick();
-        noise.tick();
-
-        if (sampleTimer <= 0.0f) {
-            sampleTimer += SAMPLE_FREQ;
-            uint16_t l = 0, r = 0;
-
-            StereoSample sample = mix(pulse1.out(), pulse2.out(), wave.out(), noise.out());
-            
-            console.platform->pushSamples(&sample, 1);
-        }
+        // run straight to the next frame sequencer step or the next point a channel's output could change
+        uint32_t span = std::min<uint32_t>({
+            cycles, divApuTimer,
+            pulse1.nextEdge(), pulse2.nextEdge(), wave.nextEdge(), noise.nextEdge()
+        });
+        cycles -= span;
+        divApuTimer -= span;
+
+        if (divApuTimer == 0) {
+            // the sequencer acts before the channels step on its cycle
+            stepChannels(span - 1);
+            stepFrameSequencer();
+            stepChannels(1);
+        } else stepChannels(span);
+
+        frameTime += span;
+        updateOutput();
+    }
+}
+
+void APU::updateOutput(void) {
+    StereoSample next = mix(pulse1.out(), pulse2.out(), wave.out(), noise.out());
+
+    if (next.l != level.l || next.r != level.r) {
+        blep.addDelta(frameTime, next.l - level.l, next.r - level.r);
+        level = next;
     }
 }
 
+void APU::flush(void) {
+    sync();
+    readOut();
+}
+
+void APU::readOut(void) {
+    // everything since the last read goes over in a single batch
+    size_t count = blep.read(output, BLEP_BUFFER_SIZE);
+    if (count) console.platform->pushSamples(output, count);
+}
+
+void APU::stepChannels(uint32_t cycles) {
+    pulse1.advance(cycles);
+    pulse2.advance(cycles);
+    wave.advance(cycles);
+    noise.advance(cycles);
+}
+
+void APU::stepFrameSequencer(void) {
+    divApuTimer = 8192;
+    switch (divApu) {
+        case 2:
+        case 6: pulse1.sweepTick(); break;
+        case 0:
+        case 4:
+            pulse1.lenTick();
+            pulse2.lenTick();
+            wave.lenTick();
+            noise.lenTick();
+            break;
+        case 7:
+            pulse1.envTick();
+            pulse2.envTick();
+            noise.envTick();
+            break;
+    }
+
+    divApu++;
+    if (divApu >= 8) divApu = 0;
+}
+
+void APU::setSampleRate(uint32_t rate) {
+    // only ever nudged between frames, so nothing in flight is stretched
+    blep.setRate(rate);
+}
+
 void APU::setEnabled(bool enabled) {
     this->enabled = enabled;
 
@@ -80,34 +139,27 @@ void APU::setEnabled(bool enabled) {
 
         divApu = 0;
         // Turning the APU off, however, does not affect [...] the DIV-APU counter.
-        sampleTimer = SAMPLE_FREQ;
         lVolume = 7;
         rVolume = 7;
         pan = 0;
     }
-}
 
-StereoSample APU::mix(uint8_t pulse1, uint8_t pulse2, uint8_t wave, uint8_t noise) {
-    StereoSample sample { 128, 128 };
-
-    if (!enabled) return sample;
-
-    uint16_t lSum = 0.0f, rSum = 0.0f;
-
-    if (pan & 0x01) lSum += pulse1;
-    if (pan & 0x02) lSum += pulse2;
-    if (pan & 0x04) lSum += wave;
-    if (pan & 0x08) lSum += noise;
-
-    if (pan & 0x10) rSum += pulse1;
-    if (pan & 0x20) rSum += pulse2;
-    if (pan & 0x40) rSum += wave;
-    if (pan & 0x80) rSum += noise;
+    updateGains();
+}
 
-    sample.l = std::min(255, static_cast<int>(lSum * (lVolume / 7.0f)));
-    sample.r = std::min(255, static_cast<int>(rSum * (rVolume / 7.0f)));
+void APU::updateGains(void) {
+    // only changes on NR50/NR51/NR52 writes, so the per-change mix is a plain dot product
+    for (int ch = 0; ch < 4; ch++) {
+        gains[0][ch] = (enabled && (pan & (0x01 << ch))) ? volumeGains[lVolume] : 0;
+        gains[1][ch] = (enabled && (pan & (0x10 << ch))) ? volumeGains[rVolume] : 0;
+    }
+}
 
-    return sample;
+StereoSample APU::mix(uint8_t pulse1, uint8_t pulse2, uint8_t wave, uint8_t noise) {
+    return {
+        static_cast<int16_t>(gains[0][0] * pulse1 + gains[0][1] * pulse2 + gains[0][2] * wave + gains[0][3] * noise),
+        static_cast<int16_t>(gains[1][0] * pulse1 + gains[1][1] * pulse2 + gains[1][2] * wave + gains[1][3] * noise)
+    };
 }
 
 } // namespace GB2040::Core
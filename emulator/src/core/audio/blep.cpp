@@ -0,0 +1,147 @@
+#include "core/audio.h"
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#define BLEP_CUTOFF 0.42 // fraction of the output rate, just short of Nyquist
+#define BLEP_HIGHPASS_SHIFT 9 // integrator leak, about 14 Hz at 44.1 kHz like the DMG's output capacitor
+
+namespace GB2040::Core
+{
+
+// the kernel is worked out by the compiler, nothing here runs on the target
+
+static constexpr double pi = 3.14159265358979323846; // M_PI isn't standard
+
+static constexpr double constSin(double x) {
+    // fold into [-pi, pi] then Taylor series, plenty for 16-bit taps
+    long long turns = (long long)(x / (2.0 * pi) + (x >= 0.0 ? 0.5 : -0.5));
+    x -= turns * 2.0 * pi;
+
+    double term = x, sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+
+    return sum;
+}
+
+static constexpr double constCos(double x) {
+    return constSin(x + pi / 2.0);
+}
+
+struct BlepKernel {
+    int16_t taps[BLEP_PHASES][BLEP_WIDTH];
+};
+
+static constexpr BlepKernel buildKernel(void) {
+    // a Blackman-windowed sinc impulse per phase, rounded so each one sums to exactly 1 << BLEP_KERNEL_BITS
+    // and integrating it back up gives a band-limited step of the right height
+    BlepKernel kernel {};
+
+    for (int phase = 0; phase < BLEP_PHASES; phase++) {
+        double frac = (double)phase / BLEP_PHASES;
+        double taps[BLEP_WIDTH] {};
+        double sum = 0.0;
+
+        for (int i = 0; i < BLEP_WIDTH; i++) {
+            double x = i - BLEP_WIDTH / 2 - frac; // distance from the step
+            double u = (i - frac + 0.5) / (BLEP_WIDTH + 1);
+
+            double sinc = x == 0.0 ? 2.0 * BLEP_CUTOFF : constSin(2.0 * pi * BLEP_CUTOFF * x) / (pi * x);
+            double window = 0.42 - 0.5 * constCos(2.0 * pi * u) + 0.08 * constCos(4.0 * pi * u);
+
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+
+        int total = 0;
+        for (int i = 0; i < BLEP_WIDTH; i++) {
+            double tap = taps[i] / sum * (1 << BLEP_KERNEL_BITS);
+            kernel.taps[phase][i] = (int16_t)(tap >= 0.0 ? tap + 0.5 : tap - 0.5);
+            total += kernel.taps[phase][i];
+        }
+
+        kernel.taps[phase][BLEP_WIDTH / 2] += (1 << BLEP_KERNEL_BITS) - total; // rounding error into the peak
+    }
+
+    return kernel;
+}
+
+static constexpr BlepKernel kernel = buildKernel();
+
+BlepBuffer::BlepBuffer(uint32_t sampleRate) {
+    setRate(sampleRate);
+    clear();
+}
+
+void BlepBuffer::setRate(uint32_t sampleRate) {
+    rate = sampleRate;
+}
+
+uint32_t BlepBuffer::getMaxClocks(void) {
+    // room left before a step's taps would run off the end
+    uint64_t room = ((uint64_t)(BLEP_BUFFER_SIZE - available - 1) << BLEP_CLOCK_SHIFT) - offset;
+    return (uint32_t)std::min<uint64_t>(room / rate, UINT32_MAX);
+}
+
+void BlepBuffer::addDelta(uint32_t time, int l, int r) {
+    uint64_t pos = offset + (uint64_t)time * rate;
+    size_t idx = available + (size_t)(pos >> BLEP_CLOCK_SHIFT);
+    const int16_t* taps = kernel.taps[(pos >> (BLEP_CLOCK_SHIFT - BLEP_PHASE_BITS)) & (BLEP_PHASES - 1)];
+
+    uint32_t* lOut = &left[idx];
+    uint32_t* rOut = &right[idx];
+
+    // straight-line multiply-adds, the compiler vectorises these
+    for (int i = 0; i < BLEP_WIDTH; i++) {
+        lOut[i] += (uint32_t)(l * taps[i]);
+        rOut[i] += (uint32_t)(r * taps[i]);
+    }
+}
+
+void BlepBuffer::endFrame(uint32_t time) {
+    uint64_t pos = offset + (uint64_t)time * rate;
+
+    available += (size_t)(pos >> BLEP_CLOCK_SHIFT);
+    offset = (uint32_t)(pos & ((1 << BLEP_CLOCK_SHIFT) - 1));
+}
+
+size_t BlepBuffer::read(StereoSample* out, size_t count) {
+    count = std::min(count, available);
+
+    for (size_t i = 0; i < count; i++) {
+        leftSum = (int32_t)((uint32_t)leftSum + left[i]);
+        rightSum = (int32_t)((uint32_t)rightSum + right[i]);
+
+        out[i].l = (int16_t)std::clamp(leftSum >> BLEP_KERNEL_BITS, -32768, 32767);
+        out[i].r = (int16_t)std::clamp(rightSum >> BLEP_KERNEL_BITS, -32768, 32767);
+
+        leftSum -= leftSum >> BLEP_HIGHPASS_SHIFT;
+        rightSum -= rightSum >> BLEP_HIGHPASS_SHIFT;
+    }
+
+    // slide what's left (including the taps hanging past the end) back to the start
+    size_t remaining = available - count + BLEP_WIDTH;
+    memmove(left, left + count, remaining * sizeof(uint32_t));
+    memmove(right, right + count, remaining * sizeof(uint32_t));
+    memset(left + remaining, 0, count * sizeof(uint32_t));
+    memset(right + remaining, 0, count * sizeof(uint32_t));
+
+    available -= count;
+    return count;
+}
+
+void BlepBuffer::clear(void) {
+    memset(left, 0, sizeof(left));
+    memset(right, 0, sizeof(right));
+
+    available = 0;
+    offset = 0;
+    leftSum = 0;
+    rightSum = 0;
+}
+
+} // namespace GB2040::Core
@@ -6,12 +6,19 @@
 namespace GB2040::Core
 {
 
-void NoiseChannel::tick(void) {
-    timer--;
+void NoiseChannel::advance(uint32_t cycles) {
+    if (cycles < timer) {
+        timer -= cycles;
+        return;
+    }
 
-    if (timer == 0) {
-        timer = divisors[clockDiv] << clockShift;
+    cycles -= timer;
+    uint32_t period = getPeriod();
+    uint32_t steps = 1 + cycles / period;
+    timer = period - cycles % period;
 
+    // the LFSR has no shortcut, but it only clocks a handful of times per span
+    while (steps--) {
         uint8_t feedback = (lfsr & 0x01) ^ ((lfsr >> 1) & 0x01);
 
         lfsr >>= 1;
@@ -28,6 +35,14 @@ void NoiseChannel::tick(void) {
     }
 }
 
+uint32_t NoiseChannel::getPeriod(void) {
+    return divisors[clockDiv] << clockShift;
+}
+
+uint32_t NoiseChannel::nextEdge(void) {
+    return (enabled && dacEnabled && volume) ? timer : UINT32_MAX;
+}
+
 void NoiseChannel::lenTick(void) {
     if (lengthTimer > 0 && lengthEnable) {
         lengthTimer--;
@@ -101,7 +116,7 @@ void NoiseChannel::init(void) {
     enabled = true;
     if (!lengthTimer) lengthTimer = 63;
 
-    timer = divisors[clockDiv] << clockShift;
+    timer = getPeriod();
     envelopeActive = (envInitVolume != 0 || envDir);
     envelopeTimer = envPeriod;
     volume = envInitVolume;
@@ -6,13 +6,21 @@
 namespace GB2040::Core
 {
 
-void PulseChannel::tick(void) {
-    timer--;
-
-    if (timer == 0) {
-        timer = getFreq();
-        dutyPos = (dutyPos + 1) % 8;
+void PulseChannel::advance(uint32_t cycles) {
+    if (cycles < timer) {
+        timer -= cycles;
+        return;
     }
+
+    // jump over every duty step in the span at once
+    cycles -= timer;
+    uint16_t period = getFreq();
+    dutyPos = (dutyPos + 1 + cycles / period) % 8;
+    timer = period - cycles % period;
+}
+
+uint32_t PulseChannel::nextEdge(void) {
+    return (enabled && dacEnabled && volume) ? timer : UINT32_MAX;
 }
 
 void PulseChannel::lenTick(void) {
@@ -6,31 +6,41 @@
 namespace GB2040::Core
 {
 
-void WaveChannel::tick(void) {
-    timer--;
+void WaveChannel::advance(uint32_t cycles) {
+    if (cycles < timer) {
+        timer -= cycles;
+        return;
+    }
+
+    // only the sample at the last step in the span is ever heard
+    cycles -= timer;
+    uint16_t period = getFreq();
+    uint32_t steps = 1 + cycles / period;
+    timer = period - cycles % period;
 
-    if (timer == 0) {
-        timer = getFreq();
+    if (!enabled || !dacEnabled) {
+        outputSample = 0;
+        return;
+    }
 
-        if (!enabled || !dacEnabled) {
-            outputSample = 0;
-            return;
-        }
+    waveformPtr = (waveformPtr + steps) % 32;
 
-        waveformPtr = (waveformPtr + 1) % 32;
+    uint8_t waveSample = waveform[waveformPtr / 2];
+    bool nibble = waveformPtr % 2;
 
-        uint8_t waveSample = waveform[waveformPtr / 2];
-        bool nibble = waveformPtr % 2;
+    if (nibble) waveSample >>= 4;
 
-        if (nibble) waveSample >>= 4;
+    waveSample &= 0x0F;
 
-        waveSample &= 0x0F;
+    if (outputLevel) waveSample >>= outputLevel - 1;
+    else waveSample = 0;
 
-        if (outputLevel) waveSample >>= outputLevel - 1;
-        else waveSample = 0;
+    outputSample = waveSample;
+}
 
-        outputSample = waveSample;
-    };
+uint32_t WaveChannel::nextEdge(void) {
+    // a silenced channel still has to step once more to drop its last sample
+    return ((enabled && dacEnabled) || outputSample) ? timer : UINT32_MAX;
 }
 
 void WaveChannel::lenTick(void) {
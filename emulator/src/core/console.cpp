@@ -52,6 +52,8 @@ Console::Console(Platform* platform, ROMSource* romSource)
             mbc = new NoMBC(*this, romSource, header.cartType);
             break;
     }
+
+    mmu.mapCartridge();
 }
 
 void Console::run(void) {
@@ -80,6 +82,8 @@ void Console::run(void) {
 
         running = platform->doEvents(*this);
 
+        if (platform->waitForAudio()) continue; // the audio device's clock sets the pace
+
         now = platform->getClock();
         if (target > now) platform->wait(target - now);
         else target = now;
@@ -87,23 +91,59 @@ void Console::run(void) {
 }
 
 size_t Console::doTicks(size_t cycles) {
-    size_t cyclesPassed = 0;
-    while (cyclesPassed < cycles) {
-        cyclesPassed += tick();
+    uint64_t start = scheduler.now;
+    uint64_t target = start + cycles;
+
+    scheduler.schedule(Event::SLICE_END, target); // so a halted CPU never skips past the slice
+
+    // the CPU runs straight up to the earliest deadline, everything else
+    // only gets a look in once its event is due (or its registers are touched)
+    while (scheduler.now < target) {
+#ifdef BLOCK_CORE
+        if (!cpu.runBlock()) scheduler.now += cpu.tick(); // blocks keep the clock themselves
+#else
+        scheduler.now += cpu.tick();
+#endif
+
+        if (scheduler.now >= scheduler.nextDeadline()) runEvents();
     }
 
-    return cyclesPassed;
+    apu.flush(); // hand this slice's samples over in one go
+
+    return scheduler.now - start;
 }
 
 size_t Console::tick(void) {
     size_t cycles = cpu.tick();
-    timer.incTimers(cycles);
-    ppu.tick(cycles);
-    apu.tick(cycles);
+    scheduler.now += cycles;
+
+    if (scheduler.now >= scheduler.nextDeadline()) runEvents();
 
     return cycles;
 }
 
+void Console::runEvents(void) {
+    Event event;
+
+    while (scheduler.popDue(event)) {
+        switch (event) {
+            case Event::PPU:
+                ppu.tick();
+                break;
+            case Event::TIMER_OVERFLOW:
+                timer.sync();
+                break;
+            case Event::TIMER_RELOAD:
+                timer.reload();
+                break;
+            case Event::SLICE_END:
+                break; // nothing to do, doTicks checks the clock itself
+            default:
+                break;
+        }
+    }
+}
+
 void Console::requestInterrupt(Interrupt interrupt) {
     mmu.writeIo(0x0F, mmu.readIo(0x0F) | (1 << static_cast<int>(interrupt)));
 }
@@ -0,0 +1,104 @@
+#include "core/cpu.h"
+#include "core/console.h"
+
+#include <cstdint>
+
+#ifdef BLOCK_CORE
+
+namespace GB2040::Core
+{
+
+static bool endsBlock(uint8_t opcode) {
+    switch (opcode) {
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9: // JP
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: // CALL
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9: // RET, RETI
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF: // RST
+        case 0x76: case 0x10: // HALT, STOP
+            return true;
+    }
+
+    return false;
+}
+
+Block* CPU::getBlock(uint16_t pc) {
+    if (pc > 0x7FFF) return nullptr; // RAM code can be rewritten under us, leave it to the interpreter
+    if (pc <= 0xFF && console.mmu.isBootRomMapped()) return nullptr;
+
+    uint32_t tag = (console.mbc->romBanks[pc >> 14] << 16) | pc;
+
+    Block& block = blocks[pc & (BLOCK_CACHE_SIZE - 1)];
+    if (block.tag == tag) return &block;
+
+    block.tag = Block::EMPTY;
+    block.count = 0;
+
+    uint16_t limit = pc | 0x3FFF; // the next bank over may not be the one mapped later
+    while (block.count < MAX_BLOCK_INSTRS) {
+        uint8_t opcode = console.mmu.read8(pc);
+        uint8_t length = InstructionCache::getLength(opcode);
+        if (pc + length - 1 > limit) break;
+
+        BlockInstr& instr = block.instrs[block.count];
+        if (opcode == 0xCB) {
+            instr.impl = cbInstrTable[console.mmu.read8(pc + 1)];
+            instr.length = 2;
+        } else {
+            instr.impl = instrTable[opcode];
+            instr.length = 1;
+
+            for (uint8_t i = 1; i < length; i++) {
+                instr.operands[i - 1] = console.mmu.read8(pc + i);
+            }
+        }
+
+        if (!instr.impl) break; // invalid opcodes lock up through the interpreter
+
+        block.count++;
+        pc += length;
+
+        if (endsBlock(opcode)) break;
+    }
+
+    if (!block.count) return nullptr;
+
+    block.tag = tag;
+    return &block;
+}
+
+bool CPU::runBlock(void) {
+    // anything tick() would have to act on between instructions goes through it instead
+    if (forceCycles || eiPending || halted || stopped || haltBug || idleLoop.active) return false;
+    if (ime && (intFlag & ie)) return false;
+
+    Block* block = getBlock(PC);
+    if (!block) return false;
+
+    Scheduler& scheduler = console.scheduler;
+    const uint16_t& bank = console.mbc->romBanks[PC >> 14];
+    uint16_t blockBank = bank;
+
+    for (uint8_t i = 0; i < block->count; i++) {
+        BlockInstr& instr = block->instrs[i];
+
+        PC += instr.length;
+        operands = instr.operands;
+
+        // handlers see the clock at the start of their instruction, same as when stepping
+        scheduler.now += (this->*instr.impl)() * 4;
+
+        // stop wherever stepping would do something besides run the next instruction
+        if (scheduler.now >= scheduler.nextDeadline()) break;
+        if (forceCycles || eiPending || idleLoop.active) break;
+        if (ime && (intFlag & ie)) break;
+        if (bank != blockBank) break; // switched out the bank we're running from
+    }
+
+    operands = nullptr;
+    return true;
+}
+
+} // namespace GB2040::Core
+
+#endif
@@ -0,0 +1,99 @@
+#include "core/icache.h"
+#include "core/console.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace GB2040::Core
+{
+
+// bytes per instruction, 0xCB counts its second opcode byte
+static constexpr uint8_t instrLengths[256] = {
+//  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1, // 0x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 1x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 2x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 3x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 4x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 5x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 6x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 7x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 8x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 9x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Ax
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Bx
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1, // Cx
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1, // Dx
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1, // Ex
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1  // Fx
+};
+
+InstructionCache::InstructionCache(Console& console)
+: console(console) {
+    for (DecodedInstr& entry : entries) entry.tag = EMPTY;
+    memset(codePages, 0, sizeof(codePages));
+}
+
+const uint8_t* InstructionCache::fetch(uint16_t pc) {
+    // returns the bytes of the instruction at pc, or nullptr if it has to be fetched as normal
+    uint32_t tag;
+    uint16_t limit; // instructions can't run past this and still be cached
+
+    if (pc <= 0x7FFF) { // ROM, tagged with whichever bank is mapped there
+        if (pc <= 0xFF && console.mmu.isBootRomMapped()) return nullptr;
+
+        tag = (console.mbc->romBanks[pc >> 14] << 16) | pc;
+        limit = pc | 0x3FFF;
+    } else if (0xC000 <= pc && pc <= 0xDFFF) { // work RAM
+        tag = pc;
+        limit = 0xDFFF;
+    } else if (0xFF80 <= pc && pc <= 0xFFFE) { // high RAM
+        tag = pc;
+        limit = 0xFFFE;
+    } else {
+        return nullptr; // rare enough not to bother (VRAM, cartridge RAM, echo RAM...)
+    }
+
+    DecodedInstr& entry = entries[pc & (ICACHE_SIZE - 1)];
+    if (entry.tag == tag) return entry.bytes;
+
+    uint8_t opcode = console.mmu.read8(pc);
+    uint8_t length = instrLengths[opcode];
+    if (pc + length - 1 > limit) return nullptr;
+
+    entry.tag = tag;
+    entry.bytes[0] = opcode;
+    for (uint8_t i = 1; i < length; i++) {
+        entry.bytes[i] = console.mmu.read8(pc + i);
+    }
+
+    if (pc >= 0x8000) {
+        markCode(pc >> 8);
+        markCode((pc + length - 1) >> 8);
+    }
+
+    return entry.bytes;
+}
+
+void InstructionCache::markCode(uint8_t page) {
+    if (codePages[page]) return;
+
+    codePages[page] = true;
+    console.mmu.protectPage(page); // so writes there reach invalidate()
+}
+
+uint8_t InstructionCache::getLength(uint8_t opcode) {
+    return instrLengths[opcode];
+}
+
+void InstructionCache::invalidate(uint16_t addr) {
+    // drop anything cached from RAM that starts at or just before addr
+    for (uint8_t i = 0; i < 3; i++) {
+        uint16_t pc = addr - i;
+
+        DecodedInstr& entry = entries[pc & (ICACHE_SIZE - 1)];
+        if (entry.tag == pc) entry.tag = EMPTY;
+    }
+}
+
+} // namespace GB2040::Core
@@ -37,13 +37,13 @@ uint8_t CPU::DEC_SP(void) {
 }
 
 uint8_t CPU::INC_r8(uint8_t& reg) {
-    setFlag(HF, (reg & 0x0F) + 1 > 0x0F); // check if nibble will overflow
+    flagHA = reg & 0x0F; // H if nibble will overflow
+    flagHB = 1;
+    flagN = false;
 
     reg++;
 
-    setFlag(ZF, reg == 0);
-    setFlag(NF, false);
-    // leave CF
+    flagZC = (flagZC & 0x100) | reg; // leave CF
 
     return 1;
 }
@@ -61,13 +61,13 @@ uint8_t CPU::INC_mHL(void) {
 }
 
 uint8_t CPU::DEC_r8(uint8_t& reg) {
-    setFlag(HF, (reg & 0x0F) == 0x00); // check if underflow
+    flagHA = reg & 0x0F; // H if nibble will underflow
+    flagHB = 1;
+    flagN = true;
 
     reg--;
 
-    setFlag(ZF, reg == 0);
-    setFlag(NF, true);
-    // leave CF
+    flagZC = (flagZC & 0x100) | reg; // leave CF
 
     return 1;
 }
@@ -90,7 +90,7 @@ uint8_t CPU::ADD_HL_r16(RegisterPair& reg) { // store in reg1
     uint16_t val = HL.get() + reg.get();
     HL.set(val);
 
-    setFlag(NF, false);
+    flagN = false;
     setFlag(HF, hCarry);
     setFlag(CF, carry);
 
@@ -106,7 +106,7 @@ uint8_t CPU::ADD_HL_SP(void) {
     uint16_t val = HL.get() + SP;
     HL.set(val);
 
-    setFlag(NF, false);
+    flagN = false;
     setFlag(HF, hCarry);
     setFlag(CF, carry);
 
@@ -124,13 +124,14 @@ uint8_t CPU::DEC_L(void) { return DEC_r8(HL.lo); }
 uint8_t CPU::DEC_A(void) { return DEC_r8(AF.hi); }
 
 uint8_t CPU::ADD_A_r8(uint8_t& reg) {
-    setFlag(HF, ((AF.hi & 0x0F) + (reg & 0x0F)) > 0x0F);
-    setFlag(CF, (uint16_t)AF.hi + (uint16_t)reg > 0xFF);
-    uint8_t val = AF.hi + reg;
-    AF.hi = val;
+    uint16_t val = AF.hi + reg;
+
+    flagZC = val; // carry lands in bit 8
+    flagHA = AF.hi & 0x0F;
+    flagHB = reg & 0x0F;
+    flagN = false;
 
-    setFlag(ZF, val == 0);
-    setFlag(NF, false);
+    AF.hi = val;
 
     return 1;
 }
@@ -151,15 +152,14 @@ uint8_t CPU::ADD_A_mHL(void) {
 uint8_t CPU::ADD_A_A(void) { return ADD_A_r8(AF.hi); }
 
 uint8_t CPU::SUB_r8(uint8_t& reg) {
-    setFlag(HF, (AF.hi & 0x0F) < (reg & 0x0F));
-    setFlag(CF, AF.hi < reg);
+    uint16_t val = AF.hi - reg;
 
-    uint8_t val = AF.hi - reg;
-    AF.hi = val;
+    flagZC = val; // a borrow sets bit 8
+    flagHA = AF.hi & 0x0F;
+    flagHB = reg & 0x0F;
+    flagN = true;
 
-    
-    setFlag(ZF, val == 0);
-    setFlag(NF, true);
+    AF.hi = val;
 
     return 1;
 }
@@ -179,14 +179,14 @@ uint8_t CPU::SUB_A(void) { return SUB_r8(AF.hi); }
 
 uint8_t CPU::ADC_A_r8(uint8_t& reg) {
     bool carry = getFlag(CF);
-    setFlag(HF, (AF.hi & 0x0F) + (reg & 0x0F) + carry > 0x0F);
-    setFlag(CF, (uint16_t)AF.hi + (uint16_t)reg + carry > 0xFF);
+    uint16_t val = AF.hi + reg + carry;
 
-    uint8_t val = AF.hi + reg + carry;
-    AF.hi = val;
+    flagZC = val;
+    flagHA = AF.hi & 0x0F;
+    flagHB = (reg & 0x0F) + carry;
+    flagN = false;
 
-    setFlag(ZF, val == 0);
-    setFlag(NF, false);
+    AF.hi = val;
 
     return 1;
 }
@@ -206,14 +206,14 @@ uint8_t CPU::ADC_A_A(void) { return ADC_A_r8(AF.hi); }
 
 uint8_t CPU::SBC_A_r8(uint8_t& reg) {
     bool carry = getFlag(CF);
-    setFlag(HF, (AF.hi & 0x0F) < ((reg & 0x0F) + carry));
-    setFlag(CF, AF.hi < (uint16_t)reg + carry);
+    uint16_t val = AF.hi - reg - carry;
+
+    flagZC = val;
+    flagHA = AF.hi & 0x0F;
+    flagHB = (reg & 0x0F) + carry;
+    flagN = true;
 
-    uint8_t val = AF.hi - reg - carry;
     AF.hi = val;
-    
-    setFlag(ZF, val == 0);
-    setFlag(NF, true);
 
     return 1;
 }
@@ -276,7 +276,7 @@ uint8_t CPU::ADD_SP_s8(void) {
     SP = val;
 
     setFlag(ZF, false);
-    setFlag(NF, false);
+    flagN = false;
     setFlag(HF, hCarry);
     setFlag(CF, carry);
 
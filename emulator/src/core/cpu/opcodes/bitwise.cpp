@@ -9,9 +9,7 @@ namespace GB2040::Core
 uint8_t CPU::RLCA(void) {
     RLC(AF.hi); // use helper from CB opcodes
 
-    setFlag(ZF, false);
-    setFlag(NF, false);
-    setFlag(HF, false);
+    flagZC |= 1; // Z is always clear, N and H already are
 
     return 1;
 }
@@ -19,9 +17,7 @@ uint8_t CPU::RLCA(void) {
 uint8_t CPU::RLA(void) {
     RL(AF.hi);
 
-    setFlag(ZF, false);
-    setFlag(NF, false);
-    setFlag(HF, false);
+    flagZC |= 1; // Z is always clear, N and H already are
 
     return 1;
 }
@@ -29,9 +25,7 @@ uint8_t CPU::RLA(void) {
 uint8_t CPU::RRCA(void) {
     RRC(AF.hi); // use helper from CB opcodes
 
-    setFlag(ZF, false);
-    setFlag(NF, false);
-    setFlag(HF, false);
+    flagZC |= 1; // Z is always clear, N and H already are
 
     return 1;
 }
@@ -39,9 +33,7 @@ uint8_t CPU::RRCA(void) {
 uint8_t CPU::RRA(void) {
     RR(AF.hi);
 
-    setFlag(ZF, false);
-    setFlag(NF, false);
-    setFlag(HF, false);
+    flagZC |= 1; // Z is always clear, N and H already are
 
     return 1;
 }
@@ -50,10 +42,10 @@ uint8_t CPU::AND_r8(uint8_t& reg) {
     uint8_t val = AF.hi & reg;
     AF.hi = val;
 
-    setFlag(ZF, val == 0);
-    setFlag(NF, false);
-    setFlag(HF, true);
-    setFlag(CF, false);
+    flagZC = val; // CF clear
+    flagHA = 0x10; // H set
+    flagHB = 0;
+    flagN = false;
 
     return 1;
 }
@@ -75,10 +67,9 @@ uint8_t CPU::OR_r8(uint8_t& reg) {
     uint8_t val = AF.hi | reg;
     AF.hi = val;
 
-    setFlag(ZF, val == 0);
-    setFlag(NF, false);
-    setFlag(HF, false);
-    setFlag(CF, false);
+    flagZC = val; // CF clear
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 1;
 }
@@ -100,10 +91,9 @@ uint8_t CPU::XOR_r8(uint8_t& reg) {
     uint8_t val = AF.hi ^ reg;
     AF.hi = val;
 
-    setFlag(ZF, val == 0);
-    setFlag(NF, false);
-    setFlag(HF, false);
-    setFlag(CF, false);
+    flagZC = val; // CF clear
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 1;
 }
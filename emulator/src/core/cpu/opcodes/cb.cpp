@@ -7,14 +7,13 @@ namespace GB2040::Core
 {
 
 uint8_t CPU::RLC(uint8_t& reg) {
-    bool bit7 = (reg >> 7) & 1;
+    uint16_t val = (reg << 1) | (reg >> 7); // bit 8 is the old bit 7, i.e. CF
 
-    reg = (reg << 1) | bit7;
+    reg = val;
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit7);
+    flagZC = val;
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -41,10 +40,9 @@ uint8_t CPU::RRC(uint8_t& reg) {
 
     reg = (reg >> 1) | (bit0 << 7);
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit0);
+    flagZC = reg | (bit0 << 8);
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -67,14 +65,13 @@ uint8_t CPU::RRC_mHL(void) {
 uint8_t CPU::RRC_A(void) { return RRC(AF.hi); }
 
 uint8_t CPU::RL(uint8_t& reg) {
-    bool bit7 = (reg >> 7) & 1;
+    uint16_t val = (reg << 1) | getFlag(CF); // bit 8 is the old bit 7, i.e. CF
 
-    reg = (reg << 1) | getFlag(CF);
+    reg = val;
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit7);
+    flagZC = val;
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -101,10 +98,9 @@ uint8_t CPU::RR(uint8_t& reg) {
 
     reg = (reg >> 1) | (getFlag(CF) << 7);
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit0);
+    flagZC = reg | (bit0 << 8);
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -127,14 +123,13 @@ uint8_t CPU::RR_mHL(void) {
 uint8_t CPU::RR_A(void) { return RR(AF.hi); }
 
 uint8_t CPU::SLA(uint8_t& reg) {
-    bool bit7 = (reg >> 7) & 1;
+    uint16_t val = reg << 1; // bit 8 is the old bit 7, i.e. CF
 
-    reg = reg << 1;
+    reg = val;
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit7);
+    flagZC = val;
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -162,10 +157,9 @@ uint8_t CPU::SRA(uint8_t& reg) {
 
     reg = (reg >> 1) | (bit7 << 7);
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit0);
+    flagZC = reg | (bit0 << 8);
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -191,10 +185,9 @@ uint8_t CPU::SWAP(uint8_t& reg) {
     uint8_t lower = reg & 0xF;
     reg = (reg >> 4) | (lower << 4);
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, false);
+    flagZC = reg; // CF clear
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -221,10 +214,9 @@ uint8_t CPU::SRL(uint8_t& reg) {
 
     reg = (reg >> 1) & 0x7F; // bit 7 zeroed
 
-    setFlag(ZF, reg == 0);
-    setFlag(HF, false);
-    setFlag(NF, false);
-    setFlag(CF, bit0);
+    flagZC = reg | (bit0 << 8);
+    flagHA = flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -247,12 +239,10 @@ uint8_t CPU::SRL_mHL(void) {
 uint8_t CPU::SRL_A(void) { return SRL(AF.hi); }
 
 uint8_t CPU::BIT(uint8_t index, uint8_t& reg) {
-    bool val = (reg >> index) & 1;
-
-    setFlag(ZF, !val);
-    setFlag(NF, false);
-    setFlag(HF, true);
-    // keep CF same
+    flagZC = (flagZC & 0x100) | (reg & (1 << index)); // keep CF same
+    flagHA = 0x10; // H set
+    flagHB = 0;
+    flagN = false;
 
     return 2;
 }
@@ -8,8 +8,11 @@ uint8_t CPU::JR_F_s8(bool flag) {
     int8_t addr = static_cast<int8_t>(fetch8());
 
     if (flag) {
+        uint16_t end = PC;
         PC += addr; // signed
 
+        if (addr < 0) detectIdleLoop(end, 3);
+
         return 3;
     }
 
@@ -39,8 +42,11 @@ uint8_t CPU::JP_F_a16(bool flag) {
     uint16_t addr = fetch16();
 
     if (flag) {
+        uint16_t end = PC;
         PC = addr;
 
+        if (addr < end) detectIdleLoop(end, 4);
+
         return 4;
     }
 
@@ -52,8 +58,11 @@ uint8_t CPU::JP_NC_a16(void) { return JP_F_a16(!getFlag(CF)); }
 
 uint8_t CPU::JP_a16(void) {
     uint16_t addr = fetch16();
+    uint16_t end = PC;
     PC = addr;
 
+    if (addr < end) detectIdleLoop(end, 4);
+
     return 4;
 }
 
@@ -214,7 +214,7 @@ uint8_t CPU::LD_HL_SP_s8(void) {
     HL.set(val);
 
     setFlag(ZF, false);
-    setFlag(NF, false);
+    flagN = false;
     setFlag(HF, hCarry);
     setFlag(CF, carry);
 
@@ -38,18 +38,16 @@ uint8_t CPU::DAA(void) { // convert A to a BCD
 
     AF.hi = a;
 
-    setFlag(ZF, AF.hi == 0);
-    setFlag(HF, false);
-    setFlag(CF, carry);
+    flagZC = a | (carry << 8);
+    flagHA = flagHB = 0; // H clear, N kept
 
     return 1;
 }
 
 uint8_t CPU::SCF(void) {
-    setFlag(NF, false);
-    setFlag(HF, false);
-    setFlag(CF, true);
-
+    flagN = false;
+    flagHA = flagHB = 0;
+    flagZC |= 0x100;
 
     return 1;
 }
@@ -57,17 +55,18 @@ uint8_t CPU::SCF(void) {
 uint8_t CPU::CPL(void) {
     AF.hi = ~AF.hi;
 
-    setFlag(NF, true);
-    setFlag(HF, true);
+    flagN = true;
+    flagHA = 0x10; // H set
+    flagHB = 0;
 
     return 1;
 }
 
 uint8_t CPU::CCF(void) {
-    setFlag(CF, !getFlag(CF));
+    flagZC ^= 0x100;
 
-    setFlag(NF, false);
-    setFlag(HF, false);
+    flagN = false;
+    flagHA = flagHB = 0;
 
     return 1;
 }
@@ -94,8 +93,8 @@ uint8_t CPU::POP_DE(void) { return POP_r16(DE); }
 uint8_t CPU::POP_HL(void) { return POP_r16(HL); }
 uint8_t CPU::POP_AF(void) { 
     uint16_t val = pop();
-    val &= 0xFFF0; // mask low nibble
-    AF.set(val);
+    AF.hi = val >> 8;
+    setF(val & 0xF0); // mask low nibble
 
     return 3;
 }
@@ -109,7 +108,11 @@ uint8_t CPU::PUSH_r16(RegisterPair& reg) {
 uint8_t CPU::PUSH_BC(void) { return PUSH_r16(BC); }
 uint8_t CPU::PUSH_DE(void) { return PUSH_r16(DE); }
 uint8_t CPU::PUSH_HL(void) { return PUSH_r16(HL); }
-uint8_t CPU::PUSH_AF(void) { return PUSH_r16(AF); }
+uint8_t CPU::PUSH_AF(void) {
+    push((AF.hi << 8) | getF());
+
+    return 4;
+}
 
 uint8_t CPU::DI(void) {
     ime = false;
@@ -0,0 +1,25 @@
+#include "core/mbc.h"
+#include "platform/platform.h"
+
+#include <cstdint>
+
+namespace GB2040::Core
+{
+
+void IMBC::mapBanks(ROMSource* romSource, RAMSource* ramSource, uint32_t ramOffset, bool ramMapped) {
+    // recomputed on bank switches only, the MMU copies these into its page table
+    uint8_t* rom = romSource->data();
+    size_t romBankCount = romSource->size() / 0x4000;
+
+    for (int i = 0; i < 2; i++) {
+        if (rom && romBankCount) romBankData[i] = rom + (romBanks[i] % romBankCount) * 0x4000; // banks past the end wrap
+        else romBankData[i] = nullptr;
+    }
+
+    uint8_t* ram = ramSource ? ramSource->data() : nullptr;
+
+    if (ram && ramMapped && ramOffset + 0x2000 <= ramSource->size()) ramBankData = ram + ramOffset;
+    else ramBankData = nullptr;
+}
+
+} // namespace GB2040::Core
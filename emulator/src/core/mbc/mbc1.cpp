@@ -24,22 +24,14 @@ MBC1::MBC1(Console& console, ROMSource* romSource, CartridgeHeader& cartHeader)
     }
 
     ramSource = console.platform->getSave(ramSize);
+
+    mapBanks(romSource, ramSource, 0, ramEnabled);
 }
 
 uint8_t MBC1::read8(uint16_t addr) {
-    if (0x0 <= addr && addr <= 0x3FFF) { // fixed ROM bank 0
-        uint32_t bank = (mode == 0) ? 0 : ((ramBank & 0x03) << 5);
-        uint32_t romAddr = bank * 0x4000 + addr;
+    if (0x0 <= addr && addr <= 0x7FFF) { // ROM, bank 0 area is only switchable in mode 1
+        uint32_t romAddr = romBanks[addr >> 14] * 0x4000 + (addr & 0x3FFF);
 
-        uint8_t v;
-        romSource->read8(romAddr, &v, 1);
-        return v;
-    } else if (0x4000 <= addr && addr <= 0x7FFF) { // switchable ROM
-        uint32_t bank = romBank & 0x1F;
-        bank |= (mode == 1) ? ((ramBank & 0x03) << 5) : 0;
-        if ((bank & 0x1F) == 0) bank = 1;
-
-        uint32_t romAddr = bank * 0x4000 + (addr - 0x4000);
         uint8_t v;
         romSource->read8(romAddr, &v, 1);
         return v;
@@ -60,16 +52,20 @@ void MBC1::write8(uint16_t addr, uint8_t val) {
     if (0x0 <= addr && addr <= 0x1FFF) {
         if (header.ramSize == 0) return;
         ramEnabled = ((val & 0x0F) == 0x0A);
+        remap();
         return;
     } else if (0x2000 <= addr && addr <= 0x3FFF) {
         romBank = (romBank & 0x60) | (val & 0x1F);
         if ((romBank & 0x1F) == 0) romBank = 1;
+        updateRomBanks();
         return;
     } else if (0x4000 <= addr && addr <= 0x5FFF) {
         ramBank = val & 0x03;
+        updateRomBanks();
         return;
     } else if (0x6000 <= addr && addr <= 0x7FFF) {
         mode = val & 0x01;
+        updateRomBanks();
     } else if (0xA000 <= addr && addr <= 0xBFFF) {
         if (!ramEnabled) return;
 
@@ -79,6 +75,25 @@ void MBC1::write8(uint16_t addr, uint8_t val) {
     }
 }
 
+void MBC1::updateRomBanks(void) {
+    romBanks[0] = (mode == 0) ? 0 : ((ramBank & 0x03) << 5);
+
+    uint16_t bank = romBank & 0x1F;
+    bank |= (mode == 1) ? ((ramBank & 0x03) << 5) : 0;
+    if ((bank & 0x1F) == 0) bank = 1;
+
+    romBanks[1] = bank;
+
+    remap();
+}
+
+void MBC1::remap(void) {
+    uint32_t ramBankOffset = ((mode == 1) ? ramBank & 0x03 : 0) * 0x2000;
+
+    mapBanks(romSource, ramSource, ramBankOffset, ramEnabled);
+    console.mmu.mapCartridge();
+}
+
 void MBC1::save(void) {
     if (header.cartType != CartType::MBC1_RAM_BATTERY) return;
 
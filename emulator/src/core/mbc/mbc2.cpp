@@ -13,6 +13,8 @@ MBC2::MBC2(Console& console, GB2040::Platform::ROMSource* romSource, CartType ca
     this->cartType = cartType;
 
     ramSource = console.platform->getSave(256);
+
+    mapBanks(romSource, nullptr, 0, false); // RAM is 4 bits wide, never mapped directly
 }
 
 uint8_t MBC2::read8(uint16_t addr) {
@@ -41,6 +43,8 @@ void MBC2::write8(uint16_t addr, uint8_t val) {
 
         if (optSelect) {
             romBank = (val & 0x0F) ? (val & 0x0F) : 1;
+            romBanks[1] = romBank;
+            remap();
         } else {
             ramEnabled = (val & 0x0F) == 0x0A;
         }
@@ -58,6 +62,11 @@ void MBC2::write8(uint16_t addr, uint8_t val) {
     }
 }
 
+void MBC2::remap(void) {
+    mapBanks(romSource, nullptr, 0, false);
+    console.mmu.mapCartridge();
+}
+
 void MBC2::save() {
     if (cartType == CartType::MBC2_BATTERY) {
         console.platform->saveData(ramSource);
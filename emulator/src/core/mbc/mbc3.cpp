@@ -18,6 +18,8 @@ MBC3::MBC3(Console& console, ROMSource* romSource, CartType cartType)
 
     rtc = parseRTC();
     rtcLatched = RTC{};
+
+    mapBanks(romSource, ramSource, 0, false);
 }
 
 uint8_t MBC3::read8(uint16_t addr) {
@@ -46,10 +48,13 @@ uint8_t MBC3::read8(uint16_t addr) {
 void MBC3::write8(uint16_t addr, uint8_t val) {
     if (0x0 <= addr && addr <= 0x1FFF) {
         ramEnabled = ((val & 0x0F) == 0x0A);
+        remap();
         return;
     } else if (0x2000 <= addr && addr <= 0x3FFF) {
         romBank = val & 0x7F;
         if (romBank == 0) romBank = 1;
+        romBanks[1] = romBank;
+        remap();
         return;
     } else if (0x4000 <= addr && addr <= 0x5FFF) {
         if (val <= 0x03) {
@@ -60,6 +65,7 @@ void MBC3::write8(uint16_t addr, uint8_t val) {
             rtcReg = val;
         }
 
+        remap();
         return;
     } else if (0x6000 <= addr && addr <= 0x7FFF) {
         if (!rtcLatchPrep && val == 0x01) {
@@ -84,6 +90,11 @@ void MBC3::write8(uint16_t addr, uint8_t val) {
     }
 }
 
+void MBC3::remap(void) {
+    mapBanks(romSource, ramSource, ramBank * 0x2000, ramEnabled && !rtcSelected); // RTC registers need readRTC
+    console.mmu.mapCartridge();
+}
+
 void MBC3::save(void) {
     if (cartType != CartType::MBC3_RAM_BATTERY &&
          cartType != CartType::MBC3_TIMER_BATTERY &&
@@ -27,6 +27,8 @@ MBC5::MBC5(Console& console, ROMSource* romSource, CartridgeHeader& cartHeader)
     }
 
     ramSource = console.platform->getSave(ramSize);
+
+    mapBanks(romSource, ramSource, 0, ramEnabled);
 }
 
 uint8_t MBC5::read8(uint16_t addr) {
@@ -55,23 +57,29 @@ void MBC5::write8(uint16_t addr, uint8_t val) {
     if (0x0 <= addr && addr <= 0x1FFF) {
         if (header.ramSize == 0) return;
         ramEnabled = ((val & 0x0F) == 0x0A);
+        remap();
         return;
     } else if (0x2000 <= addr && addr <= 0x2FFF) {
         uint16_t maxBank = (header.romSize * 1024 / 0x4000) - 1;
         romBank = (romBank & 0x100) | val;
 
         romBank &= maxBank;
+        romBanks[1] = romBank;
+        remap();
         return;
     } else if (0x3000 <= addr && addr <= 0x3FFF) {
         uint16_t maxBank = (header.romSize * 1024 / 0x4000) - 1;
         romBank = (romBank & 0xFF) | ((val & 0x01) << 8);
 
         romBank &= maxBank;
+        romBanks[1] = romBank;
+        remap();
         return;
     } else if (0x4000 <= addr && addr <= 0x5FFF) {
         if (val <= 0x0F) {
             uint8_t maxRamBank = (ramSize / 0x2000) - 1;
             ramBank = val & maxRamBank;
+            remap();
         }
     }
 
@@ -83,6 +91,11 @@ void MBC5::write8(uint16_t addr, uint8_t val) {
     }
 }
 
+void MBC5::remap(void) {
+    mapBanks(romSource, ramSource, ramBank * 0x2000, ramEnabled);
+    console.mmu.mapCartridge();
+}
+
 void MBC5::save(void) {
     if (header.cartType != CartType::MBC5_RAM_BATTERY &&
          header.cartType != CartType::MBC5_RUMBLE_RAM_BATTERY) return;
@@ -11,6 +11,9 @@ namespace GB2040::Core
 NoMBC::NoMBC(Console& console, GB2040::Platform::ROMSource* romSource, CartType cartType)
 : console(console), romSource(romSource) {
     memset(ram, 0, sizeof(ram));
+
+    mapBanks(romSource, nullptr, 0, false);
+    ramBankData = ram; // never switches, so this is all the mapping there is
 }
 
 uint8_t NoMBC::read8(uint16_t addr) {
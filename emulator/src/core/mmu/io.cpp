@@ -7,6 +7,8 @@ namespace GB2040::Core
 {
 
 uint8_t MMU::readIo(uint16_t port) {
+    if (0x10 <= port && port <= 0x3F) console.apu.sync(); // bring channels up to date first
+
     switch (port) {
         case 0x00:
             return console.getInputRegister();
@@ -15,8 +17,10 @@ uint8_t MMU::readIo(uint16_t port) {
             // TODO: serial
             return 0xFF;
         case 0x04:
+            console.timer.sync();
             return console.timer.getDiv();
         case 0x05:
+            console.timer.sync();
             return console.timer.tima;
         case 0x06:
             return console.timer.tma;
@@ -76,12 +80,14 @@ uint8_t MMU::readIo(uint16_t port) {
         case 0x40:
             return console.ppu.lcdc;
         case 0x41:
+            console.ppu.sync();
             return console.ppu.stat;
         case 0x42:
             return console.ppu.scy;
         case 0x43:
             return console.ppu.scx;
         case 0x44:
+            console.ppu.sync();
             return console.ppu.ly;
         case 0x45:
             return console.ppu.lyc;
@@ -104,6 +110,15 @@ uint8_t MMU::readIo(uint16_t port) {
 }
 
 void MMU::writeIo(uint16_t port, uint8_t val) {
+    // writes apply from the current cycle onwards
+    if (0x10 <= port && port <= 0x3F) console.apu.sync();
+    else if (0x40 <= port && port <= 0x4B) {
+        console.ppu.sync();
+
+        // lines already transferred have to be drawn with the old values (STAT, LY and LYC don't affect pixels)
+        if (port != 0x41 && port != 0x44 && port != 0x45) console.ppu.prepareRegisterWrite();
+    }
+
     switch (port) {
         case 0x00:
             console.inputSelectButtons = val & 0x20;
@@ -114,16 +129,21 @@ void MMU::writeIo(uint16_t port, uint8_t val) {
             // TODO: serial
             return;
         case 0x04:
+            console.timer.sync();
             console.timer.resetSysCounter();
             return;
         case 0x05:
+            console.timer.sync();
             console.timer.tima = val;
+            console.timer.schedule();
             return;
         case 0x06:
             console.timer.tma = val;
             return;
         case 0x07:
+            console.timer.sync();
             console.timer.tac = val;
+            console.timer.schedule();
             return;
         case 0x0F:
             console.cpu.intFlag = val & 0x1F;
@@ -163,10 +183,12 @@ void MMU::writeIo(uint16_t port, uint8_t val) {
             if (!console.apu.enabled) return;
             console.apu.rVolume = val & 0x07;
             console.apu.lVolume = (val >> 4) & 0x07;
+            console.apu.updateGains();
             return;
         case 0x25:
             if (!console.apu.enabled) return;
             console.apu.pan = val;
+            console.apu.updateGains();
             return;
         case 0x26:
             console.apu.setEnabled(val & 0x80); // handles disabling channels, clearing registers etc
@@ -191,11 +213,14 @@ void MMU::writeIo(uint16_t port, uint8_t val) {
             console.apu.wave.writeReg(port - 0x1A, val);
             return;
         case 0x40:
+            if ((console.ppu.lcdc ^ val) & 0x04) console.ppu.objectListsDirty = true; // object height
             console.ppu.lcdc = val;
+            console.ppu.scheduleUpdate();
             return;
         case 0x41:
             val &= 0xF8;
             console.ppu.stat = val;
+            console.ppu.scheduleUpdate();
             return;
         case 0x42:
             console.ppu.scy = val;
@@ -206,6 +231,7 @@ void MMU::writeIo(uint16_t port, uint8_t val) {
         case 0x44: return; // don't allow writes to LY
         case 0x45:
             console.ppu.lyc = val;
+            console.ppu.scheduleUpdate();
             return;
         case 0x46:
             console.ppu.oamDma(val);
@@ -228,6 +254,7 @@ void MMU::writeIo(uint16_t port, uint8_t val) {
         case 0x50:
             if (bootRomMapped && val != 0) {
                 bootRomMapped = false;
+                mapCartridge(); // page 0 goes back to the cartridge
             }
             return;
         default:
@@ -12,9 +12,53 @@ MMU::MMU(Console& console)
   bootRomMapped(true) {
     memset(internalWram, 0, WRAM_SIZE);
     memset(hram, 0, HRAM_SIZE);
+
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        readPages[page] = nullptr;
+        writePages[page] = nullptr;
+    }
+
+    readPages[0x00] = console.bootRom; // until $FF50 is written
+
+    for (int page = 0x80; page <= 0x9F; page++) {
+        readPages[page] = console.ppu.vram + ((page - 0x80) << 8); // writes sync the PPU first
+    }
+
+    for (int page = 0xC0; page <= 0xFD; page++) { // work RAM and its echo
+        uint8_t* wram = internalWram + (((page - 0xC0) & 0x1F) << 8);
+        readPages[page] = wram;
+        writePages[page] = wram;
+    }
+}
+
+void MMU::mapCartridge(void) {
+    // called when the MBC has switched banks
+    IMBC* mbc = console.mbc;
+
+    for (int page = 0x00; page <= 0x7F; page++) {
+        const uint8_t* bank = mbc->romBankData[page >> 6];
+        readPages[page] = bank ? bank + ((page & 0x3F) << 8) : nullptr;
+    }
+
+    if (bootRomMapped) readPages[0x00] = console.bootRom;
+
+    for (int page = 0xA0; page <= 0xBF; page++) { // writes to ROM stay MBC register writes
+        uint8_t* bank = mbc->ramBankData;
+        uint8_t* ram = bank ? bank + ((page - 0xA0) << 8) : nullptr;
+
+        readPages[page] = ram;
+        writePages[page] = ram;
+    }
+}
+
+void MMU::protectPage(uint8_t page) {
+    // writes to this page have side effects now (e.g. it holds cached code)
+    writePages[page] = nullptr;
+
+    if (0xC0 <= page && page <= 0xDD) writePages[page + 0x20] = nullptr; // echo RAM
 }
 
-uint8_t MMU::read8(uint16_t addr) {
+uint8_t MMU::readSlow(uint16_t addr) {
     if (0x0 <= addr && addr <= 0xFF && bootRomMapped) { // boot ROM
         return console.bootRom[addr];
     } else if (0x0 <= addr && addr <= 0x7FFF) { // ROM
@@ -22,14 +66,17 @@ uint8_t MMU::read8(uint16_t addr) {
     } else if (0x8000 <= addr && addr <= 0x9FFF) { // VRAM
         return console.ppu.readVram(addr - 0x8000);
     } else if (0xA000 <= addr && addr <= 0xBFFF) { // external RAM
+        if (watching) noteRead(addr);
         return console.mbc->read8(addr);
     } else if (0xC000 <= addr && addr <= 0xDFFF) { // work RAM (always bank 0)
         return internalWram[addr - 0xC000];
     } else if (0xE000 <= addr && addr <= 0xFDFF) { // echo RAM
-        return read8(addr - 0x2000);
+        return readSlow(addr - 0x2000);
     } else if (0xFE00 <= addr && addr <= 0xFE9F) { // OAM
+        if (watching) noteRead(addr);
         return console.ppu.readOam(addr - 0xFE00);
     } else if (0xFF00 <= addr && addr <= 0xFF7F) { // I/O registers
+        if (watching) noteRead(addr);
         return readIo(addr - 0xFF00);
     } else if (0xFF80 <= addr && addr <= 0xFFFE) { // high RAM
         return hram[addr - 0xFF80];
@@ -47,7 +94,7 @@ uint16_t MMU::read16(uint16_t addr) {
     return (hi << 8) | lo;
 }
 
-void MMU::write8(uint16_t addr, uint8_t val) {
+void MMU::writeSlow(uint16_t addr, uint8_t val) {
     if (0x0 <= addr && addr <= 0x100 && bootRomMapped) {
         return; // discard attempted writes to boot ROM, SHOULD never happen but ya never know
     } else if (0x0 <= addr && addr <= 0x7FFF) { // ROM
@@ -58,14 +105,16 @@ void MMU::write8(uint16_t addr, uint8_t val) {
         console.mbc->write8(addr, val);
     } else if (0xC000 <= addr && addr <= 0xDFFF) { // work RAM
         internalWram[addr - 0xC000] = val;
+        if (console.cpu.icache.hasCode(addr)) console.cpu.icache.invalidate(addr);
     } else if (0xE000 <= addr && addr <= 0xFDFF) { // echo RAM
-        write8(addr - 0x2000, val); // unsupported by nintendo
+        writeSlow(addr - 0x2000, val); // unsupported by nintendo
     } else if (0xFE00 <= addr && addr <= 0xFE9F) { // OAM
         console.ppu.writeOam(addr - 0xFE00, val);
     } else if (0xFF00 <= addr && addr <= 0xFF7F) { // I/O registers
         writeIo(addr - 0xFF00, val);
     } else if (0xFF80 <= addr && addr <= 0xFFFE) { // high RAM
         hram[addr - 0xFF80] = val;
+        if (console.cpu.icache.hasCode(addr)) console.cpu.icache.invalidate(addr);
     } else if (addr == 0xFFFF) {
         console.cpu.ie = val;
     } else { // reserved space, etc
@@ -78,4 +127,41 @@ void MMU::write16(uint16_t addr, uint16_t val) {
     write8(addr + 1, val >> 8);
 }
 
+void MMU::watch(bool enable) {
+    watching = enable;
+    watchedDeadline = Scheduler::NEVER;
+}
+
+void MMU::noteRead(uint16_t addr) {
+    // taken at read time, so a change between the read and the end of the loop still counts
+    uint64_t change = getNextChange(addr);
+    if (change < watchedDeadline) watchedDeadline = change;
+}
+
+uint64_t MMU::getNextChange(uint16_t addr) {
+    // earliest timestamp a read of addr could return something new, short of a write
+    uint64_t now = console.scheduler.now;
+
+    if (0xFF00 <= addr && addr <= 0xFF7F) {
+        uint8_t port = addr - 0xFF00;
+
+        switch (port) {
+            case 0x04: return console.timer.getNextDivChange();
+            case 0x05: return console.timer.getNextTimaChange();
+            case 0x41: return console.ppu.getNextStatChange();
+            case 0x44: return console.ppu.getNextLyChange();
+        }
+
+        if (0x10 <= port && port <= 0x3F) return now; // channel status moves on its own
+
+        return console.scheduler.nextDeadline(); // otherwise only the CPU or an event changes it
+    }
+
+    return now; // OAM locks with the PPU mode, cartridge RAM may be an RTC
+}
+
+uint64_t MMU::getWatchedDeadline(void) {
+    return watchedDeadline;
+}
+
 } // namespace GB2040::Core
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "core/scheduler.h"
+
+#include <cstdint>
+
+namespace GB2040::Core
+{
+
+Scheduler::Scheduler(void)
+: now(0), next(NEVER) {
+    for (size_t i = 0; i < static_cast<size_t>(Event::COUNT); i++) {
+        deadlines[i] = NEVER;
+    }
+}
+
+void Scheduler::schedule(Event event, uint64_t when) {
+    deadlines[static_cast<size_t>(event)] = when;
+
+    if (when < next) next = when;
+    else updateNext(); // the slot may have held the old minimum
+}
+
+void Scheduler::cancel(Event event) {
+    deadlines[static_cast<size_t>(event)] = NEVER;
+    updateNext();
+}
+
+bool Scheduler::popDue(Event& event) {
+    if (next > now) return false;
+
+    // fire the earliest event first so handlers see time move forwards
+    size_t earliest = 0;
+    for (size_t i = 1; i < static_cast<size_t>(Event::COUNT); i++) {
+        if (deadlines[i] < deadlines[earliest]) earliest = i;
+    }
+
+    event = static_cast<Event>(earliest);
+    deadlines[earliest] = NEVER;
+    updateNext();
+
+    return true;
+}
+
+void Scheduler::updateNext(void) {
+    next = NEVER;
+
+    for (size_t i = 0; i < static_cast<size_t>(Event::COUNT); i++) {
+        if (deadlines[i] < next) next = deadlines[i];
+    }
+}
+
+} // namespace GB2040::Core
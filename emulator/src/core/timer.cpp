@@ -4,47 +4,90 @@
 namespace GB2040::Core
 {
 
+static constexpr uint16_t freqRates[4] = { 1024, 16, 64, 256 };
+
 Timer::Timer(Console& console)
 : console(console), timaOverflow(false) {  }
-    
-void Timer::incTimers(size_t cycles) {
-    sysCounter += cycles;
 
-    bool timerEnabled = tac & 0x04;
-    if (!timerEnabled) return;
-    
-    uint8_t old = tima;
+void Timer::sync(void) {
+    uint64_t now = console.scheduler.now;
+    uint64_t cycles = now - lastSync;
+    lastSync = now;
 
-    uint16_t freqRates[4] = { 1024, 16, 64, 256 };
-    uint16_t freq = freqRates[tac & 0x03];
+    sysCounter += cycles;
 
-    timaCounter += cycles;
-    bool timaOverflowN = false;
+    bool timerEnabled = tac & 0x04;
+    if (timerEnabled) {
+        uint16_t freq = freqRates[tac & 0x03];
 
-    while (timaCounter >= freq) {
-        timaCounter -= freq;
+        // advance TIMA by however many periods have passed since the last sync
+        uint64_t counter = timaCounter + cycles;
+        uint64_t increments = counter / freq;
+        timaCounter = counter % freq;
 
-        if (tima == 0xFF) {
-            tima = 0x00;
-            timaOverflowN = true;
-        } else {
-            tima++;
+        if (tima + increments > 0xFF) {
+            // TMA is reloaded (and the interrupt raised) after the *next* instruction
+            timaOverflow = true;
+            console.scheduler.schedule(Event::TIMER_RELOAD, now + 1);
         }
+
+        tima += increments;
     }
 
-    if (timaOverflow) {
-        timaOverflow = false;
+    schedule();
+}
+
+void Timer::reload(void) {
+    bool overflowed = timaOverflow;
+    timaOverflow = false;
+
+    sync(); // may flag a fresh overflow for the next instruction
+
+    if (overflowed) {
         tima = tma;
         console.requestInterrupt(Interrupt::TIMER);
+
+        schedule();
     }
+}
 
-    if (timaOverflowN) timaOverflow = true;
+void Timer::schedule(void) {
+    bool timerEnabled = tac & 0x04;
+    if (!timerEnabled) {
+        console.scheduler.cancel(Event::TIMER_OVERFLOW);
+        return;
+    }
+
+    uint16_t freq = freqRates[tac & 0x03];
+
+    // cycles until TIMA goes from $FF to $00
+    uint64_t cycles = (0x100 - tima) * freq;
+    cycles = cycles > timaCounter ? cycles - timaCounter : 0;
+
+    console.scheduler.schedule(Event::TIMER_OVERFLOW, lastSync + cycles);
 }
 
 uint8_t Timer::getDiv(void) {
     return sysCounter >> 8;
 }
 
+uint64_t Timer::getNextDivChange(void) {
+    sync();
+
+    return lastSync + (0x100 - (sysCounter & 0xFF));
+}
+
+uint64_t Timer::getNextTimaChange(void) {
+    sync();
+
+    bool timerEnabled = tac & 0x04;
+    if (!timerEnabled) return Scheduler::NEVER;
+
+    uint16_t freq = freqRates[tac & 0x03];
+
+    return lastSync + (freq - timaCounter);
+}
+
 void Timer::resetSysCounter(void) {
     sysCounter = 0;
 }
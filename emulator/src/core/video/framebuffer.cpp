@@ -5,32 +5,33 @@ namespace GB2040::Core
 {
 
 Framebuffer::Framebuffer(unsigned int w, unsigned int h)
+#ifdef INDEXED_FRAMEBUFFER
+: w(w), h(h), fb((w * h + 3) / 4) {
+#else
 : w(w), h(h), fb(w * h) {
+#endif
     clear();
 }
 
 void Framebuffer::clear() {
-    Colour white = 0xFFFF;
-
-    std::fill(fb.begin(), fb.end(), white);
-}
-
-Colour Framebuffer::getPixel(unsigned int x, unsigned int y) {
-    // get index into fb
-    unsigned int idx = y * w + x;
-    
-    return fb[idx];
-}
-
-void Framebuffer::setPixel(unsigned int x, unsigned int y, Colour colour) {
-    // get index into fb
-    unsigned int idx = y * w + x;
-
-    fb[idx] = colour;
-}
-
-Colour* Framebuffer::data(void) {
-    return fb.data();
+#ifdef INDEXED_FRAMEBUFFER
+    std::fill(fb.begin(), fb.end(), 0x00); // shade 0 is white
+#else
+    std::fill(fb.begin(), fb.end(), 0xFFFF);
+#endif
+}
+
+void Framebuffer::setLine(unsigned int y, const Pixel* line) {
+    // a whole row at once, w pixels
+#ifdef INDEXED_FRAMEBUFFER
+    uint8_t* dst = fb.data() + y * w / 4; // rows start on a byte as long as w is a multiple of 4
+
+    for (unsigned int x = 0; x < w; x += 4) {
+        *dst++ = line[x] | (line[x + 1] << 2) | (line[x + 2] << 4) | (line[x + 3] << 6);
+    }
+#else
+    std::copy(line, line + w, getRow(y));
+#endif
 }
 
 size_t Framebuffer::size(void) {
@@ -5,10 +5,31 @@
 #include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <array>
 
 namespace GB2040::Core
 {
 
+static constexpr std::array<uint64_t, 256> makeBitplaneLut(void) {
+    // spreads a bitplane byte over 8 bytes, leftmost pixel (bit 7) in the lowest byte
+    std::array<uint64_t, 256> lut {};
+
+    for (int val = 0; val < 256; val++) {
+        for (int px = 0; px < 8; px++) {
+            lut[val] |= (uint64_t)((val >> (7 - px)) & 1) << (px * 8);
+        }
+    }
+
+    return lut;
+}
+
+static constexpr std::array<uint64_t, 256> bitplaneLut = makeBitplaneLut();
+
+static inline uint64_t decodeTileRow(uint8_t low, uint8_t high) {
+    // 8 colour indices, one per byte in screen order (little-endian hosts)
+    return bitplaneLut[low] | (bitplaneLut[high] << 1);
+}
+
 PPU::PPU(Console& console)
 : console(console), framebuffer(console.platform->getBackBuffer()),
 mode(PPUMode::HBLANK), modeClock(0),
@@ -17,35 +38,190 @@ scx(0), scy(0) {
     // initialise VRAM
     memset(vram, 0, VRAM_SIZE);
     memset(oam, 0, OAM_SIZE);
+
+#ifdef TILE_CACHE
+    for (bool& dirty : tileDirty) dirty = true;
+#endif
 }
 
-void PPU::tick(size_t cycles) {
-    modeClock += cycles;
+void PPU::tick(void) {
+    sync();
+
+    if (!(lcdc & 0x80)) return; // ppu disabled, nothing to do until LCDC is written
+
+    updateStat(); // register writes can raise STAT without a mode change
+    schedule();
+}
+
+void PPU::sync(void) {
+    // catch up on every transition since the last sync, rendering lines as we pass them
+    uint64_t now = console.scheduler.now;
+    modeClock += now - lastSync;
+    lastSync = now;
 
     if (!(lcdc & 0x80)) {
         // ppu disabled
         modeClock = 0;
         ly = 0;
+        splitX = 0;
 
         return;
     }
 
+    uint32_t modeCycles = getModeCycles();
+    while (modeClock >= modeCycles) {
+        modeClock -= modeCycles;
+
+        switch (mode) {
+            case PPUMode::HBLANK:
+                hBlank();
+                break;
+            case PPUMode::VBLANK:
+                vBlank();
+                break;
+            case PPUMode::OAM_SCAN:
+                oamScan();
+                break;
+            case PPUMode::PIXEL_TRANSFER:
+                pixelTransfer();
+                break;
+        }
+
+        updateStat();
+        modeCycles = getModeCycles();
+    }
+}
+
+void PPU::schedule(void) {
+    // only wake up for transitions that can raise an interrupt, everything
+    // else is caught up on when the CPU next looks at the PPU
+    uint32_t pos = getFramePosition();
+
+    auto until = [pos](uint32_t target) -> uint32_t {
+        return target > pos ? target - pos : target + CYCLES_PER_FRAME - pos;
+    };
+
+    uint32_t cycles = until(144 * 456); // vblank is always requested
+
+    if (stat & 0x08) { // mode 0
+        // mode 3 length isn't known until it starts, waking up early just reschedules
+        uint32_t target;
+        if (ly < 144 && mode == PPUMode::PIXEL_TRANSFER) target = ly * 456 + 80 + transferCycles;
+        else if (ly < 144 && mode == PPUMode::OAM_SCAN) target = ly * 456 + 252;
+        else target = (ly + 1 > 143 ? 0 : ly + 1) * 456 + 252;
+
+        cycles = std::min(cycles, until(target));
+    }
+
+    if (stat & 0x20) { // mode 2
+        uint32_t line = pos / 456 + 1;
+        if (line > 143) line = 0;
+        cycles = std::min(cycles, until(line * 456));
+    }
+
+    if ((stat & 0x40) && lyc <= 153) { // LY=LYC
+        cycles = std::min(cycles, until(lyc ? lyc * 456 : CYCLES_PER_FRAME));
+    }
+
+    console.scheduler.schedule(Event::PPU, lastSync + cycles);
+}
+
+void PPU::scheduleUpdate(void) {
+    // re-evaluate once the current instruction has finished
+    console.scheduler.schedule(Event::PPU, console.scheduler.now);
+}
+
+uint64_t PPU::getNextLyChange(void) {
+    sync();
+
+    if (!(lcdc & 0x80)) return Scheduler::NEVER; // held at 0 until the LCD is turned back on
+
+    // LY only moves at the end of HBlank and at the end of each VBlank line
+    uint32_t cycles = getModeCycles() - modeClock;
     switch (mode) {
-        case PPUMode::HBLANK:
-            hBlank();
-            break;
-        case PPUMode::VBLANK:
-            vBlank();
-            break;
-        case PPUMode::OAM_SCAN:
-            oamScan();
-            break;
-        case PPUMode::PIXEL_TRANSFER:
-            pixelTransfer();
-            break;
+        case PPUMode::OAM_SCAN: cycles += 376; break;
+        case PPUMode::PIXEL_TRANSFER: cycles += 376 - transferCycles; break;
+        default: break;
     }
 
-    // STAT
+    return lastSync + cycles;
+}
+
+uint64_t PPU::getNextStatChange(void) {
+    sync();
+
+    if (!(lcdc & 0x80)) return Scheduler::NEVER; // mode 0 and LY 0 until the LCD is turned back on
+
+    // the mode bits and the LYC coincidence flag only move at a mode or line boundary
+    return lastSync + getModeCycles() - modeClock;
+}
+
+uint32_t PPU::getModeCycles(void) {
+    switch (mode) {
+        case PPUMode::HBLANK: return 376 - transferCycles;
+        case PPUMode::VBLANK: return 456; // per line
+        case PPUMode::OAM_SCAN: return 80;
+        case PPUMode::PIXEL_TRANSFER: return transferCycles;
+    }
+
+    return 456;
+}
+
+uint32_t PPU::getFramePosition(void) {
+    // cycles since the start of line 0
+    uint32_t lineStart = ly * 456;
+
+    switch (mode) {
+        case PPUMode::OAM_SCAN: return lineStart + modeClock;
+        case PPUMode::PIXEL_TRANSFER: return lineStart + 80 + modeClock;
+        case PPUMode::HBLANK: return lineStart + 80 + transferCycles + modeClock;
+        case PPUMode::VBLANK: return lineStart + modeClock;
+    }
+
+    return lineStart;
+}
+
+uint32_t PPU::getTransferCycles(void) {
+    // 172 at the least, plus the fine scroll discarded, the window restarting the fetcher and each object fetch
+    uint32_t cycles = 172 + scx % 8;
+
+    if (isWindowVisible(ly)) cycles += 6;
+
+    if (lcdc & 0x02) {
+        Sprite lineSprites[10];
+        uint8_t count = selectLineSprites(ly, lineSprites);
+
+        for (int i = 0; i < count; i++) cycles += getObjectPenalty(lineSprites[i]);
+    }
+
+    return cycles;
+}
+
+uint32_t PPU::getObjectPenalty(const Sprite& sprite) {
+    // 6 for the fetch, up to 5 more waiting for the background tile under it
+    // (objects sharing a tile all pay the wait here, real hardware only charges the first)
+    return 11 - std::min((sprite.x + scx) % 8, 5);
+}
+
+uint8_t PPU::getTransferX(void) {
+    // how many pixels of the current line have reached the LCD
+    int x = (int)modeClock - 12 - scx % 8; // the first tile fetch, then the fine scroll is thrown away
+
+    if (lcdc & 0x02) {
+        Sprite lineSprites[10];
+        uint8_t count = selectLineSprites(ly, lineSprites);
+
+        for (int i = 0; i < count && lineSprites[i].x - 8 < x; i++) { // sorted by X, so in fetch order
+            x -= getObjectPenalty(lineSprites[i]);
+        }
+    }
+
+    if (isWindowVisible(ly) && x > wx - 7) x -= 6;
+
+    return std::clamp(x, 0, GB_WIDTH);
+}
+
+void PPU::updateStat(void) {
     bool hBlankStat = (mode == PPUMode::HBLANK)   && (stat & 0x08);
     bool vBlankStat = (mode == PPUMode::VBLANK)   && (stat & 0x10);
     bool oamStat    = (mode == PPUMode::OAM_SCAN) && (stat & 0x20);
@@ -66,177 +242,195 @@ void PPU::tick(size_t cycles) {
 }
 
 void PPU::hBlank(void) {
-    memset(objectPixelsDrawn, 0, sizeof(objectPixelsDrawn));
+    ly++;
+    if (ly == 144) {
+        renderPending(); // usually the whole frame in one go
 
-    if (modeClock >= 204) {
-        modeClock -= 204;
-        ly++;
-        if (ly == 144) {
-            wly = 0;
-
-            console.requestInterrupt(Interrupt::VBLANK);
-            mode = PPUMode::VBLANK;
-            console.platform->draw();
-        } else {
-            mode = PPUMode::OAM_SCAN;
-        }
+        wly = 0;
+
+        console.requestInterrupt(Interrupt::VBLANK);
+        mode = PPUMode::VBLANK;
+        if (renderFrame) console.platform->draw(); // a skipped frame has nothing new to show
+
+        frameCount++;
+        renderFrame = renderInterval && frameCount % renderInterval == 0;
+    } else {
+        mode = PPUMode::OAM_SCAN;
     }
 }
 
 void PPU::vBlank(void) {
-    if (modeClock >= 456) {
-        modeClock -= 456;
-        ly++;
-        if (ly > 153) {
-            ly = 0;
-            mode = PPUMode::OAM_SCAN;
-        }
+    ly++;
+    if (ly > 153) {
+        ly = 0;
+        mode = PPUMode::OAM_SCAN;
     }
 }
 
 void PPU::oamScan(void) {
-    if (modeClock >= 80) {
-        modeClock -= 80;
-
-        for (int i = 0; i < 160; i += 4) {
-            sprites[i / 4].y = oam[i];
-            sprites[i / 4].x = oam[i + 1];
-            sprites[i / 4].tileIdx = oam[i + 2];
-            sprites[i / 4].attrs = oam[i + 3];
-            sprites[i / 4].oamIdx = i / 4;
-        }
+    transferCycles = getTransferCycles();
+    mode = PPUMode::PIXEL_TRANSFER;
+}
 
-        mode = PPUMode::PIXEL_TRANSFER;
+void PPU::pixelTransfer(void) {
+    // the line is only drawn by renderPending, so frames without raster effects are drawn all at once
+    if (ly == 0) renderedLines = 0;
+    transferredLines = ly + 1;
+
+    if (splitX) {
+        // finish the split line with the registers as they are at the end of mode 3
+        renderSpan(ly, splitX, GB_WIDTH);
+        if (splitWindow) wly++;
+
+        renderedLines = transferredLines;
+        splitX = 0;
+        splitWindow = false;
     }
+
+    mode = PPUMode::HBLANK;
 }
 
-void PPU::pixelTransfer(void) {
-    if (modeClock >= 172) {
-        modeClock -= 172;
-        renderScanline();
+void PPU::renderPending(void) {
+    // call before anything a transferred line depends on changes (registers, VRAM, OAM)
+    if (!renderFrame) {
+        renderedLines = transferredLines; // skipped, the window line counter only matters while drawing
+        return;
+    }
 
-        mode = PPUMode::HBLANK;
+    while (renderedLines < transferredLines) {
+        renderScanline(renderedLines++);
     }
 }
 
-void PPU::renderScanline(void) {
-    if (lcdc & 0x01) { // bg & window enabled
-        renderScanlineLayer(PPULayer::BACKGROUND);
+void PPU::prepareRegisterWrite(void) {
+    // call after sync() and before a register that affects pixels changes
+    renderPending();
 
-        if (lcdc & 0x20) { // window enabled
-            renderScanlineLayer(PPULayer::WINDOW);
-        }
-    } else {
-        for (int x = 0; x < GB_WIDTH; x++) {
-            framebuffer->setPixel(x, ly, dmgLut[0]);
-            bgLineIndices[x] = 0;
-        }
-    }
+    // lines without a mode 3 write never get here, and stay on the scanline renderer
+    if (!(lcdc & 0x80) || mode != PPUMode::PIXEL_TRANSFER || !renderFrame) return;
 
-    if (lcdc & 0x02) { // objects enabled
-        renderScanlineObjects();
+    uint8_t x = getTransferX();
+    if (x > splitX) {
+        renderSpan(ly, splitX, x);
+        splitX = x;
     }
 }
 
-void PPU::renderScanlineLayer(PPULayer layer) {
-    if (layer == PPULayer::WINDOW && ly < wy) return;
+void PPU::setRenderInterval(uint32_t interval) {
+    // 1 draws every frame, N every Nth one, 0 turns rendering off (e.g. headless runs)
+    renderInterval = interval;
+    frameCount = 0;
+    renderFrame = interval != 0;
+}
 
-    bool drewWindowPixel = false;
+void PPU::renderScanline(uint8_t line) {
+    memset(objectPixelsDrawn, 0, sizeof(objectPixelsDrawn));
 
-    for (int x = 0; x < GB_WIDTH; x++) {
-        if (layer == PPULayer::WINDOW) {
-            if (x + 7 < wx) continue;
+    for (int i = 0; i < 4; i++) {
+        bgPalette[i] = shadePixel((bgp >> i * 2) & 0x03);
+    }
 
-            // window is completely offscreen
-            if (wx < 7 || wx > 166 || wy > 143) continue;
+    if (lcdc & 0x01) { // bg & window enabled
+        renderScanlineLayer(PPULayer::BACKGROUND, line);
 
-            drewWindowPixel = true;
+        if (lcdc & 0x20) { // window enabled
+            renderScanlineLayer(PPULayer::WINDOW, line);
         }
-        
-        renderScanlinePixel(layer, x);
+    } else {
+        std::fill(linePixels, linePixels + GB_WIDTH, shadePixel(0));
+        memset(bgLineIndices, 0, sizeof(bgLineIndices));
     }
 
-    if (layer == PPULayer::WINDOW && drewWindowPixel) wly++;
+    if (lcdc & 0x02) { // objects enabled
+        renderScanlineObjects(line);
+    }
+
+    framebuffer->setLine(line, linePixels);
 }
 
-void PPU::renderScanlinePixel(PPULayer layer, uint8_t x) {
-    uint16_t mapBase = getMapBase(layer);
+void PPU::renderScanlineLayer(PPULayer layer, uint8_t line) {
+    uint8_t startX; // first screen column the layer covers
+    uint8_t bgX, bgY; // layer coordinates of that column
 
-    uint8_t bgX, bgY;
     if (layer == PPULayer::WINDOW) {
-        bgX = x - (wx - 7);
-        bgY = wly;
+        if (line < wy) return;
+
+        // window is completely offscreen
+        if (wx < 7 || wx > 166 || wy > 143) return;
+
+        startX = wx - 7;
+        bgX = 0;
+        bgY = wly++;
     } else {
-        bgX = scx + x;
-        bgY = scy + ly;
+        startX = 0;
+        bgX = scx;
+        bgY = scy + line;
     }
 
-    uint8_t tileY = bgY / 8;
-    uint8_t tileX = bgX / 8;
+    uint16_t mapRow = getMapBase(layer) + (bgY / 8) * 32;
+    uint8_t fineX = bgX % 8;
 
-    uint8_t pixelX = bgX % 8;
-    uint8_t pixelY = bgY % 8;
+    // whole tile rows, starting with the one under startX
+    uint8_t indices[GB_WIDTH + 8];
+    Pixel pixels[GB_WIDTH + 8];
 
-    uint8_t tileId = vram[mapBase + tileY * 32 + tileX];
+    int count = GB_WIDTH - startX + fineX;
+    for (int i = 0; i < count; i += 8) {
+        uint8_t tileX = (bgX / 8 + i / 8) % 32;
+        uint64_t row = getTileRow(getTileRowAddr(vram[mapRow + tileX], bgY % 8));
+        memcpy(indices + i, &row, 8);
 
-    uint16_t tileAddr;
-    if (lcdc & 0x10) { // unsigned addressing
-        tileAddr = 0x0 + tileId * 16;
-    } else { // signed addressing
-        tileAddr = 0x1000 + (int8_t)tileId * 16;
+        for (int px = 0; px < 8; px++) {
+            pixels[i + px] = bgPalette[indices[i + px]];
+        }
     }
 
-    tileAddr += pixelY * 2;
+    memcpy(bgLineIndices + startX, indices + fineX, GB_WIDTH - startX);
+    memcpy(linePixels + startX, pixels + fineX, (GB_WIDTH - startX) * sizeof(Pixel));
+}
 
-    // GB tile data is split into 2 bytes, one for each bitplane (low bit followed by high bit)
-    uint8_t low = vram[tileAddr];
-    uint8_t high = vram[tileAddr + 1];
+uint16_t PPU::getTileRowAddr(uint8_t tileId, uint8_t line) {
+    // GB tile data is split into 2 bytes per row, one for each bitplane (low bit followed by high bit)
+    if (lcdc & 0x10) { // unsigned addressing
+        return tileId * 16 + line * 2;
+    } else { // signed addressing
+        return 0x1000 + (int8_t)tileId * 16 + line * 2;
+    }
+}
 
-    // get relevant bits from bitplanes
-    uint8_t highBit = (high >> (7 - pixelX)) & 1;
-    uint8_t lowBit = (low >> (7 - pixelX)) & 1;
-    uint8_t colourIdx = (highBit << 1) | lowBit;
+uint64_t PPU::getTileRow(uint16_t addr) {
+    // colour indices of the tile row at addr, see decodeTileRow
+#ifdef TILE_CACHE
+    uint16_t tile = addr / 16;
+    if (tileDirty[tile]) decodeTile(tile);
 
-    bgLineIndices[x] = colourIdx;
+    return tileRows[tile][(addr / 2) % 8];
+#else
+    return decodeTileRow(vram[addr], vram[addr + 1]);
+#endif
+}
 
-    Colour finalColour = dmgLut[(bgp >> colourIdx * 2) & 0x03];
+#ifdef TILE_CACHE
+void PPU::decodeTile(uint16_t tile) {
+    for (int line = 0; line < 8; line++) {
+        uint16_t addr = tile * 16 + line * 2;
+        tileRows[tile][line] = decodeTileRow(vram[addr], vram[addr + 1]);
+    }
 
-    framebuffer->setPixel(x, ly, finalColour);
+    tileDirty[tile] = false;
 }
+#endif
 
-void PPU::renderScanlineObjects(void) {
-    uint8_t spriteHeight = lcdc & 0x04 ? 16 : 8;
-
-    uint8_t spritesLoaded = 0;
+void PPU::renderScanlineObjects(uint8_t line) {
     Sprite lineSprites[10];
-    for (uint8_t i = 0; i < 40; i++) {
-        Sprite& sprite = sprites[i];
-
-        if (sprite.y == 0 || sprite.y >= GB_HEIGHT + 16) continue; // sprite is offscreen
-        if (spritesLoaded >= 10) continue; // only draw 10 sprites per scanline
-        if ((ly - (sprite.y - 16)) > spriteHeight - 1 || ly < sprite.y - 16) continue; // if no part of the sprite intersects with this line
-        lineSprites[spritesLoaded] = sprite;
-        spritesLoaded++;
-    }
-
-    sortSprites(lineSprites, spritesLoaded);
+    uint8_t spritesLoaded = selectLineSprites(line, lineSprites);
     
     for (int i = 0; i < spritesLoaded; i++) {
         Sprite& sprite = lineSprites[i];
-        uint8_t tileIdx = sprite.tileIdx;
-
-        bool verFlip = sprite.attrs & 0x40;
-
-        uint8_t lineInTile = ly - (sprite.y - 16);
-        if (verFlip) lineInTile = spriteHeight - 1 - lineInTile;
+        uint64_t row = getObjectRow(sprite, line);
 
-        uint8_t tileLine = lineInTile % 8;
-        uint16_t tileAddr = (spriteHeight == 16) ? (tileIdx & 0xFE) * 16 : tileIdx * 16;
-        if (spriteHeight == 16 && lineInTile >= 8) tileAddr += 16;
-        tileAddr += tileLine * 2;
-
-        uint8_t low = vram[tileAddr];
-        uint8_t high = vram[tileAddr + 1];
+        uint8_t pixels[8];
+        memcpy(pixels, &row, 8);
 
         bool priority = sprite.attrs & 0x80;
         
@@ -245,19 +439,13 @@ void PPU::renderScanlineObjects(void) {
             bool visible = absX < GB_WIDTH;
 
             if (visible && !objectPixelsDrawn[absX] && (priority == false || bgLineIndices[absX] == 0)) {
-                bool horFlip = sprite.attrs & 0x20;
-
-                uint8_t bitPos = horFlip ? relX : 7 - relX;
-                uint8_t highBit = (high >> bitPos) & 1;
-                uint8_t lowBit = (low >> bitPos) & 1;
-
-                uint8_t colourIdx = highBit << 1 | lowBit;
+                uint8_t colourIdx = pixels[relX];
 
                 uint8_t obp = sprite.attrs & 0x10 ? obp1 : obp0;
-                Colour finalColour = dmgLut[(obp >> colourIdx * 2) & 0x03];
+                Pixel finalColour = shadePixel((obp >> colourIdx * 2) & 0x03);
 
                 if (colourIdx) {
-                    framebuffer->setPixel(absX, ly, finalColour);
+                    linePixels[absX] = finalColour;
                     objectPixelsDrawn[absX] = true;
                 }
             }
@@ -265,11 +453,125 @@ void PPU::renderScanlineObjects(void) {
     }
 }
 
-void PPU::sortSprites(Sprite* sprites, size_t count) {
-    std::sort(sprites, sprites + count, [](const Sprite& a, const Sprite& b) {
-        if (a.x == b.x) return a.oamIdx < b.oamIdx;
-        return a.x < b.x;
-    });
+void PPU::renderSpan(uint8_t line, uint8_t fromX, uint8_t toX) {
+    // a pixel at a time with the registers as they are now, only used for split lines
+    bool window = isWindowVisible(line);
+
+    Sprite lineSprites[10];
+    uint8_t spritesLoaded = lcdc & 0x02 ? selectLineSprites(line, lineSprites) : 0;
+
+    uint64_t objectRows[10];
+    for (int i = 0; i < spritesLoaded; i++) objectRows[i] = getObjectRow(lineSprites[i], line);
+
+    for (int x = fromX; x < toX; x++) {
+        uint8_t bgIdx = 0;
+        Pixel colour = shadePixel(0);
+
+        if (lcdc & 0x01) { // bg & window enabled
+            bool inWindow = window && x + 7 >= wx;
+            if (inWindow) splitWindow = true;
+
+            uint8_t bgX = inWindow ? x + 7 - wx : scx + x;
+            uint8_t bgY = inWindow ? wly : scy + line;
+            uint16_t mapRow = getMapBase(inWindow ? PPULayer::WINDOW : PPULayer::BACKGROUND) + (bgY / 8) * 32;
+
+            uint64_t tileRow = getTileRow(getTileRowAddr(vram[mapRow + bgX / 8], bgY % 8));
+            bgIdx = (tileRow >> (bgX % 8 * 8)) & 0x03;
+            colour = shadePixel((bgp >> bgIdx * 2) & 0x03);
+        }
+
+        // same priority rules as renderScanlineObjects
+        for (int i = 0; i < spritesLoaded; i++) {
+            Sprite& sprite = lineSprites[i];
+
+            uint8_t relX = x - (sprite.x - 8);
+            if (relX >= 8) continue;
+
+            uint8_t colourIdx = (objectRows[i] >> (relX * 8)) & 0x03;
+            if (!colourIdx || ((sprite.attrs & 0x80) && bgIdx)) continue;
+
+            uint8_t obp = sprite.attrs & 0x10 ? obp1 : obp0;
+            colour = shadePixel((obp >> colourIdx * 2) & 0x03);
+            break;
+        }
+
+        linePixels[x] = colour;
+    }
+
+    framebuffer->setLine(line, linePixels); // split lines are drawn over several calls, linePixels holds the rest meanwhile
+}
+
+bool PPU::isWindowVisible(uint8_t line) {
+    return (lcdc & 0x21) == 0x21 && line >= wy && wx >= 7 && wx <= 166 && wy <= 143;
+}
+
+uint8_t PPU::selectLineSprites(uint8_t line, Sprite* lineSprites) {
+    // the first 10 objects in OAM on this line, in drawing priority order
+    if (objectListsDirty) buildObjectLists();
+
+    uint8_t count = lineObjectCount[line];
+    for (int i = 0; i < count; i++) {
+        uint8_t idx = lineObjects[line][i];
+        const uint8_t* entry = oam + idx * 4;
+
+        lineSprites[i] = { entry[0], entry[1], entry[2], entry[3], idx };
+    }
+
+    return count;
+}
+
+void PPU::buildObjectLists(void) {
+    // one pass over OAM, dropping each object into the lines it covers
+    uint8_t spriteHeight = lcdc & 0x04 ? 16 : 8;
+
+    memset(lineObjectCount, 0, sizeof(lineObjectCount));
+
+    for (uint8_t idx = 0; idx < 40; idx++) {
+        uint8_t y = oam[idx * 4];
+        uint8_t x = oam[idx * 4 + 1];
+
+        if (y == 0 || y >= GB_HEIGHT + 16) continue; // sprite is offscreen
+
+        int top = std::max(y - 16, 0);
+        int bottom = std::min(y - 16 + spriteHeight, GB_HEIGHT);
+
+        for (int line = top; line < bottom; line++) {
+            uint8_t& count = lineObjectCount[line];
+            if (count >= 10) continue; // only draw 10 sprites per scanline
+
+            // insertion keeps X order, and later OAM entries go after equal X
+            uint8_t* list = lineObjects[line];
+            int pos = count++;
+            while (pos > 0 && oam[list[pos - 1] * 4 + 1] > x) {
+                list[pos] = list[pos - 1];
+                pos--;
+            }
+            list[pos] = idx;
+        }
+    }
+
+    objectListsDirty = false;
+}
+
+uint64_t PPU::getObjectRow(const Sprite& sprite, uint8_t line) {
+    // the sprite's colour indices on this line, flips applied
+    uint8_t spriteHeight = lcdc & 0x04 ? 16 : 8;
+    uint8_t tileIdx = sprite.tileIdx;
+
+    bool verFlip = sprite.attrs & 0x40;
+
+    uint8_t lineInTile = line - (sprite.y - 16);
+    if (verFlip) lineInTile = spriteHeight - 1 - lineInTile;
+
+    uint8_t tileLine = lineInTile % 8;
+    uint16_t tileAddr = (spriteHeight == 16) ? (tileIdx & 0xFE) * 16 : tileIdx * 16;
+    if (spriteHeight == 16 && lineInTile >= 8) tileAddr += 16;
+    tileAddr += tileLine * 2;
+
+    uint64_t row = getTileRow(tileAddr);
+    if (sprite.attrs & 0x20) row = __builtin_bswap64(row); // horizontal flip just reverses the bytes
+
+    return row;
 }
 
 uint16_t PPU::getMapBase(PPULayer layer) {
@@ -285,6 +587,8 @@ void PPU::oamDma(uint8_t high) {
         oam[i] = console.mmu.read8(high << 8 | i);
     }
 
+    objectListsDirty = true;
+
     console.cpu.yieldCycles(160 * 4); // DMA takes 160 cycles to run
 }
 
@@ -304,10 +608,19 @@ void PPU::writeVram(uint16_t addr, uint8_t val) {
     // if (mode == PPUMode::PIXEL_TRANSFER) {
     //     return;
     // }
+    sync();
+    renderPending();
+
     vram[addr] = val;
+
+#ifdef TILE_CACHE
+    if (addr < TILE_COUNT * 16) tileDirty[addr / 16] = true;
+#endif
 }
 
 uint8_t PPU::readOam(uint16_t addr) {
+    sync();
+
     if (mode == PPUMode::OAM_SCAN || mode == PPUMode::PIXEL_TRANSFER) {
         return 0xFF;
     }
@@ -316,11 +629,16 @@ uint8_t PPU::readOam(uint16_t addr) {
 }
 
 void PPU::writeOam(uint16_t addr, uint8_t val) {
+    sync();
+
     if (mode == PPUMode::OAM_SCAN || mode == PPUMode::PIXEL_TRANSFER) {
         return;
     }
 
+    renderPending();
     oam[addr] = val;
+
+    if (addr % 4 < 2) objectListsDirty = true; // Y or X moved, tile and attributes are read at render time
 }
 
 uint8_t PPU::readStat(void) {
@@ -0,0 +1,554 @@
+#include "core/scaler.h"
+#include "core/graphics.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCALER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SCALER_NEON
+#endif
+
+#define SCALER_PAD 2 // neighbours needed either side of a pixel, xBR looks 2 out
+
+namespace GB2040::Core
+{
+
+static void loadRow(Framebuffer& src, int y, Colour* row) {
+    // fills row[-SCALER_PAD, width + SCALER_PAD), the frame's edges repeat outwards
+    int w = src.getWidth();
+    y = std::clamp(y, 0, (int)src.getHeight() - 1);
+
+#ifdef INDEXED_FRAMEBUFFER
+    for (int x = 0; x < w; x++) row[x] = src.getPixel(x, y);
+#else
+    memcpy(row, src.getRow(y), w * sizeof(Colour));
+#endif
+
+    for (int i = 1; i <= SCALER_PAD; i++) {
+        row[-i] = row[0];
+        row[w - 1 + i] = row[w - 1];
+    }
+}
+
+static void nearestRow(const Colour* row, Colour* out, unsigned int w, unsigned int factor) {
+    unsigned int x = 0;
+
+    if (factor == 1) {
+        memcpy(out, row, w * sizeof(Colour));
+        return;
+    }
+
+#if defined(SCALER_SSE2)
+    if (factor == 2 || factor == 4) {
+        for (; x + 8 <= w; x += 8) {
+            __m128i p = _mm_loadu_si128((const __m128i*)(row + x));
+            __m128i lo = _mm_unpacklo_epi16(p, p);
+            __m128i hi = _mm_unpackhi_epi16(p, p);
+
+            if (factor == 2) {
+                _mm_storeu_si128((__m128i*)(out + x * 2), lo);
+                _mm_storeu_si128((__m128i*)(out + x * 2 + 8), hi);
+            } else {
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_unpacklo_epi32(lo, lo));
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 8), _mm_unpackhi_epi32(lo, lo));
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 16), _mm_unpacklo_epi32(hi, hi));
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 24), _mm_unpackhi_epi32(hi, hi));
+            }
+        }
+    }
+#elif defined(SCALER_NEON)
+    if (factor == 2 || factor == 4) {
+        for (; x + 8 <= w; x += 8) {
+            uint16x8_t p = vld1q_u16(row + x);
+            uint16x8x2_t twice = vzipq_u16(p, p);
+
+            if (factor == 2) {
+                vst1q_u16(out + x * 2, twice.val[0]);
+                vst1q_u16(out + x * 2 + 8, twice.val[1]);
+            } else {
+                uint16x8x2_t lo = vzipq_u16(twice.val[0], twice.val[0]);
+                uint16x8x2_t hi = vzipq_u16(twice.val[1], twice.val[1]);
+                vst1q_u16(out + x * 4, lo.val[0]);
+                vst1q_u16(out + x * 4 + 8, lo.val[1]);
+                vst1q_u16(out + x * 4 + 16, hi.val[0]);
+                vst1q_u16(out + x * 4 + 24, hi.val[1]);
+            }
+        }
+    }
+#endif
+
+    for (; x < w; x++) {
+        std::fill(out + x * factor, out + (x + 1) * factor, row[x]);
+    }
+}
+
+static void scale2xRow(const Colour* above, const Colour* row, const Colour* below, Colour* out0, Colour* out1, unsigned int w) {
+    // rows are padded by at least 1, out0/out1 get 2w pixels each
+    int x = 0;
+
+#if defined(SCALER_SSE2)
+    auto select = [](__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    };
+
+    for (; x + 8 <= (int)w; x += 8) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(above + x));
+        __m128i h = _mm_loadu_si128((const __m128i*)(below + x));
+        __m128i d = _mm_loadu_si128((const __m128i*)(row + x - 1));
+        __m128i e = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i f = _mm_loadu_si128((const __m128i*)(row + x + 1));
+
+        // B != H && D != F
+        __m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(b, h), _mm_cmpeq_epi16(d, f)), _mm_set1_epi16(-1));
+
+        __m128i e0 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(d, b)), d, e);
+        __m128i e1 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(b, f)), f, e);
+        __m128i e2 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(d, h)), d, e);
+        __m128i e3 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(h, f)), f, e);
+
+        _mm_storeu_si128((__m128i*)(out0 + x * 2), _mm_unpacklo_epi16(e0, e1));
+        _mm_storeu_si128((__m128i*)(out0 + x * 2 + 8), _mm_unpackhi_epi16(e0, e1));
+        _mm_storeu_si128((__m128i*)(out1 + x * 2), _mm_unpacklo_epi16(e2, e3));
+        _mm_storeu_si128((__m128i*)(out1 + x * 2 + 8), _mm_unpackhi_epi16(e2, e3));
+    }
+#elif defined(SCALER_NEON)
+    for (; x + 8 <= (int)w; x += 8) {
+        uint16x8_t b = vld1q_u16(above + x);
+        uint16x8_t h = vld1q_u16(below + x);
+        uint16x8_t d = vld1q_u16(row + x - 1);
+        uint16x8_t e = vld1q_u16(row + x);
+        uint16x8_t f = vld1q_u16(row + x + 1);
+
+        // B != H && D != F
+        uint16x8_t edge = vmvnq_u16(vorrq_u16(vceqq_u16(b, h), vceqq_u16(d, f)));
+
+        uint16x8x2_t top, bottom;
+        top.val[0] = vbslq_u16(vandq_u16(edge, vceqq_u16(d, b)), d, e);
+        top.val[1] = vbslq_u16(vandq_u16(edge, vceqq_u16(b, f)), f, e);
+        bottom.val[0] = vbslq_u16(vandq_u16(edge, vceqq_u16(d, h)), d, e);
+        bottom.val[1] = vbslq_u16(vandq_u16(edge, vceqq_u16(h, f)), f, e);
+
+        vst2q_u16(out0 + x * 2, top); // interleaves the pairs
+        vst2q_u16(out1 + x * 2, bottom);
+    }
+#endif
+
+    for (; x < (int)w; x++) {
+        Colour b = above[x], h = below[x];
+        Colour d = row[x - 1], e = row[x], f = row[x + 1];
+
+        bool edge = b != h && d != f;
+
+        out0[x * 2]     = edge && d == b ? d : e;
+        out0[x * 2 + 1] = edge && b == f ? f : e;
+        out1[x * 2]     = edge && d == h ? d : e;
+        out1[x * 2 + 1] = edge && h == f ? f : e;
+    }
+}
+
+// xBR works on colour channels, whichever way round the bytes are stored
+static inline Colour toRgb565(Colour colour) {
+#ifdef RGB565_BIG_ENDIAN
+    return (colour << 8) | (colour >> 8);
+#else
+    return colour;
+#endif
+}
+
+static inline Colour blend(Colour dst, Colour src, int weight) {
+    // dst moved weight/256 of the way towards src
+    Colour a = toRgb565(dst), b = toRgb565(src);
+
+    int r = (a >> 11) + ((((b >> 11) - (a >> 11)) * weight) >> 8);
+    int g = ((a >> 5) & 0x3F) + (((((b >> 5) & 0x3F) - ((a >> 5) & 0x3F)) * weight) >> 8);
+    int bl = (a & 0x1F) + ((((b & 0x1F) - (a & 0x1F)) * weight) >> 8);
+
+    return toRgb565((r << 11) | (g << 5) | bl); // swapping is its own inverse
+}
+
+struct Yuv {
+    int y, u, v;
+};
+
+static inline Yuv toYuv(Colour colour) {
+    Colour c = toRgb565(colour);
+
+    int r = ((c >> 11) << 3) | (c >> 13);
+    int g = (((c >> 5) & 0x3F) << 2) | ((c >> 9) & 0x03);
+    int b = ((c & 0x1F) << 3) | ((c >> 2) & 0x07);
+
+    return { // BT.601 in 8.8 fixed point
+        (77 * r + 150 * g + 29 * b) >> 8,
+        (-43 * r - 85 * g + 128 * b) >> 8,
+        (128 * r - 107 * g - 21 * b) >> 8
+    };
+}
+
+static inline int yuvDistance(const Yuv& a, const Yuv& b) {
+    return 48 * abs(a.y - b.y) + 7 * abs(a.u - b.u) + 6 * abs(a.v - b.v);
+}
+
+// the neighbours xBR looks at, named as in the reference implementation for its bottom right corner
+enum XbrNeighbour { XE, XB, XC, XD, XF, XG, XH, XI, XF4, XI4, XH5, XI5, XBR_NEIGHBOURS };
+
+static constexpr int xbrOffsets[XBR_NEIGHBOURS][2] {
+    { 0, 0 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 },
+    { 2, 0 }, { 2, 1 }, { 0, 2 }, { 1, 2 }
+};
+
+static constexpr void rotate(int& x, int& y, int turns) {
+    // quarter turns, bottom right -> top right -> top left -> bottom left
+    for (int i = 0; i < turns; i++) {
+        int t = x;
+        x = y;
+        y = -t;
+    }
+}
+
+static constexpr std::array<std::array<std::array<int, 2>, XBR_NEIGHBOURS>, 4> makeXbrNeighbourMap(void) {
+    // the offsets of every neighbour as seen from each corner
+    std::array<std::array<std::array<int, 2>, XBR_NEIGHBOURS>, 4> map {};
+
+    for (int corner = 0; corner < 4; corner++) {
+        for (int n = 0; n < XBR_NEIGHBOURS; n++) {
+            int x = xbrOffsets[n][0], y = xbrOffsets[n][1];
+            rotate(x, y, corner);
+            map[corner][n] = { x, y };
+        }
+    }
+
+    return map;
+}
+
+static constexpr std::array<std::array<uint8_t, 16>, 4> makeXbrBlockMap(int size) {
+    // output pixel index for each pixel of the block as seen from each corner
+    std::array<std::array<uint8_t, 16>, 4> map {};
+
+    for (int corner = 0; corner < 4; corner++) {
+        for (int i = 0; i < size * size; i++) {
+            int x = (i % size) * 2 - (size - 1); // centred, so rotating stays on the grid
+            int y = (i / size) * 2 - (size - 1);
+            rotate(x, y, corner);
+            map[corner][i] = ((y + size - 1) / 2) * size + (x + size - 1) / 2;
+        }
+    }
+
+    return map;
+}
+
+static constexpr auto xbrNeighbourMap = makeXbrNeighbourMap();
+static constexpr auto xbrBlockMap2 = makeXbrBlockMap(2);
+static constexpr auto xbrBlockMap4 = makeXbrBlockMap(4);
+
+static void xbrPixel(const Colour* const* rows, const Yuv* const* yuvRows, int x, unsigned int n, Colour* block) {
+    // rows/yuvRows are centred on the pixel's row (rows[-2] to rows[2]), block is n*n
+    std::fill(block, block + n * n, rows[0][x]);
+
+    for (int corner = 0; corner < 4; corner++) {
+        const auto& offsets = xbrNeighbourMap[corner];
+        auto at = [&](int n) { return rows[offsets[n][1]][x + offsets[n][0]]; };
+
+        // nothing to smooth unless E differs from both pixels next to the corner (flat areas stop here)
+        if (at(XE) == at(XH) || at(XE) == at(XF)) continue;
+
+        Colour p[XBR_NEIGHBOURS];
+        const Yuv* yuv[XBR_NEIGHBOURS];
+
+        for (int i = 0; i < XBR_NEIGHBOURS; i++) {
+            p[i] = at(i);
+            yuv[i] = &yuvRows[offsets[i][1]][x + offsets[i][0]];
+        }
+
+        auto df = [&yuv](int a, int b) { return yuvDistance(*yuv[a], *yuv[b]); };
+
+        // edge strength along the corner's diagonal, against across it
+        int e = df(XE, XC) + df(XE, XG) + df(XI, XH5) + df(XI, XF4) + (df(XH, XF) << 2);
+        int i = df(XH, XD) + df(XH, XI5) + df(XF, XI4) + df(XF, XB) + (df(XE, XI) << 2);
+
+        Colour px = df(XE, XF) <= df(XE, XH) ? p[XF] : p[XH];
+
+        const uint8_t* out = n == 2 ? xbrBlockMap2[corner].data() : xbrBlockMap4[corner].data();
+        auto mix = [&](int idx, int weight) { block[out[idx]] = blend(block[out[idx]], px, weight); };
+        auto set = [&](int idx, Colour colour) { block[out[idx]] = colour; };
+
+        bool edge = e < i && ((p[XF] != p[XB] && p[XH] != p[XD]) ||
+                              (p[XE] == p[XI] && p[XF] != p[XI4] && p[XH] != p[XI5]) ||
+                              p[XE] == p[XG] || p[XE] == p[XC]);
+
+        if (!edge) {
+            if (e <= i) mix(n * n - 1, n == 2 ? 64 : 128); // soften the corner a little
+            continue;
+        }
+
+        // a shallow edge runs along the bottom, a steep one up the right hand side
+        int ke = df(XF, XG), ki = df(XH, XC);
+        bool shallow = (ke << 1) <= ki && p[XE] != p[XG] && p[XD] != p[XG];
+        bool steep = ke >= (ki << 1) && p[XE] != p[XC] && p[XB] != p[XC];
+
+        if (n == 2) {
+            if (shallow && steep) {
+                mix(3, 224);
+                mix(2, 64);
+                set(1, block[out[2]]);
+            } else if (shallow) {
+                mix(3, 192);
+                mix(2, 64);
+            } else if (steep) {
+                mix(3, 192);
+                mix(1, 64);
+            } else {
+                mix(3, 128);
+            }
+        } else {
+            if (shallow && steep) {
+                mix(13, 192);
+                mix(12, 64);
+                set(15, px);
+                set(14, px);
+                set(11, px);
+                set(10, block[out[12]]);
+                set(3, block[out[12]]);
+                set(7, block[out[13]]);
+            } else if (shallow) {
+                mix(11, 192);
+                mix(13, 192);
+                mix(10, 64);
+                mix(12, 64);
+                set(14, px);
+                set(15, px);
+            } else if (steep) {
+                mix(14, 192);
+                mix(7, 192);
+                mix(10, 64);
+                mix(3, 64);
+                set(11, px);
+                set(15, px);
+            } else {
+                mix(11, 128);
+                mix(14, 128);
+                set(15, px);
+            }
+        }
+    }
+}
+
+Scaler::Scaler(ScaleFilter filter, unsigned int factor)
+: filter(filter), factor(factor) {
+
+}
+
+bool Scaler::supports(ScaleFilter filter, unsigned int factor) {
+    switch (filter) {
+        case ScaleFilter::NEAREST: return factor >= 1 && factor <= 8;
+        case ScaleFilter::SCALE2X: return factor == 2 || factor == 4; // 4x is scale2x twice
+        case ScaleFilter::SCALE3X: return factor == 3;
+        case ScaleFilter::XBR: return factor == 2 || factor == 4;
+    }
+
+    return false;
+}
+
+ScaleFilter Scaler::getFilter(void) {
+    return filter;
+}
+
+unsigned int Scaler::getFactor(void) {
+    return factor;
+}
+
+void Scaler::scale(Framebuffer& src, Colour* dst, unsigned int dstPitch, unsigned int firstRow, unsigned int rows) {
+    // scales source rows [firstRow, firstRow + rows) into the rows they cover in dst (the whole output, pitch in pixels),
+    // so a frame can be split into bands and handed out to several threads
+    switch (filter) {
+        case ScaleFilter::NEAREST:
+            scaleNearest(src, dst, dstPitch, firstRow, rows);
+            break;
+        case ScaleFilter::SCALE2X:
+            if (factor == 4) scaleScale4x(src, dst, dstPitch, firstRow, rows);
+            else scaleScale2x(src, dst, dstPitch, firstRow, rows);
+            break;
+        case ScaleFilter::SCALE3X:
+            scaleScale3x(src, dst, dstPitch, firstRow, rows);
+            break;
+        case ScaleFilter::XBR:
+            scaleXbr(src, dst, dstPitch, firstRow, rows);
+            break;
+    }
+}
+
+void Scaler::scaleNearest(Framebuffer& src, Colour* dst, unsigned int dstPitch, unsigned int firstRow, unsigned int rows) {
+    unsigned int w = src.getWidth();
+    std::vector<Colour> row(w + SCALER_PAD * 2);
+
+    for (unsigned int y = firstRow; y < firstRow + rows; y++) {
+        loadRow(src, y, row.data() + SCALER_PAD);
+
+        Colour* out = dst + y * factor * dstPitch;
+        nearestRow(row.data() + SCALER_PAD, out, w, factor);
+
+        for (unsigned int i = 1; i < factor; i++) { // the rest of the rows are copies
+            memcpy(out + i * dstPitch, out, w * factor * sizeof(Colour));
+        }
+    }
+}
+
+void Scaler::scaleScale2x(Framebuffer& src, Colour* dst, unsigned int dstPitch, unsigned int firstRow, unsigned int rows) {
+    unsigned int stride = src.getWidth() + SCALER_PAD * 2;
+    std::vector<Colour> buffer(stride * 3);
+
+    Colour* above = buffer.data() + SCALER_PAD;
+    Colour* row = above + stride;
+    Colour* below = row + stride;
+
+    for (unsigned int y = firstRow; y < firstRow + rows; y++) {
+        loadRow(src, (int)y - 1, above);
+        loadRow(src, y, row);
+        loadRow(src, y + 1, below);
+
+        Colour* out = dst + y * 2 * dstPitch;
+        scale2xRow(above, row, below, out, out + dstPitch, src.getWidth());
+    }
+}
+
+void Scaler::scaleScale4x(Framebuffer& src, Colour* dst, unsigned int dstPitch, unsigned int firstRow, unsigned int rows) {
+    // scale2x of the scale2x output, so the band's 2x rows plus one either side are made first
+    unsigned int w = src.getWidth();
+    unsigned int h = src.getHeight();
+
+    unsigned int first = firstRow ? firstRow - 1 : 0;
+    unsigned int last = std::min(firstRow + rows + 1, h); // source rows [first, last)
+
+    unsigned int srcStride = w + SCALER_PAD * 2;
+    unsigned int midStride = w * 2 + SCALER_PAD * 2;
+
+    std::vector<Colour> srcRows(srcStride * 3);
+    std::vector<Colour> midRows(midStride * (last - first) * 2);
+
+    Colour* above = srcRows.data() + SCALER_PAD;
+    Colour* row = above + srcStride;
+    Colour* below = row + srcStride;
+
+    auto mid = [&](int y2) { // 2x row y2, clamped to the frame
+        y2 = std::clamp(y2, 0, (int)h * 2 - 1);
+        return midRows.data() + SCALER_PAD + (y2 - (int)first * 2) * midStride;
+    };
+
+    for (unsigned int y = first; y < last; y++) {
+        loadRow(src, (int)y - 1, above);
+        loadRow(src, y, row);
+        loadRow(src, y + 1, below);
+
+        Colour* out0 = mid(y * 2);
+        Colour* out1 = mid(y * 2 + 1);
+        scale2xRow(above, row, below, out0, out1, w);
+
+        for (Colour* out : { out0, out1 }) {
+            out[-1] = out[0];
+            out[w * 2] = out[w * 2 - 1];
+        }
+    }
+
+    for (unsigned int y2 = firstRow * 2; y2 < (firstRow + rows) * 2; y2++) {
+        Colour* out = dst + y2 * 2 * dstPitch;
+        scale2xRow(mid(y2 - 1), mid(y2), mid(y2 + 1), out, out + dstPitch, w * 2);
+    }
+}
+
+void Scaler::scaleScale3x(Framebuffer& src, Colour* dst, unsigned int dstPitch, unsigned int firstRow, unsigned int rows) {
+    unsigned int w = src.getWidth();
+    unsigned int stride = w + SCALER_PAD * 2;
+    std::vector<Colour> buffer(stride * 3);
+
+    Colour* above = buffer.data() + SCALER_PAD;
+    Colour* row = above + stride;
+    Colour* below = row + stride;
+
+    for (unsigned int y = firstRow; y < firstRow + rows; y++) {
+        loadRow(src, (int)y - 1, above);
+        loadRow(src, y, row);
+        loadRow(src, y + 1, below);
+
+        Colour* out0 = dst + y * 3 * dstPitch;
+        Colour* out1 = out0 + dstPitch;
+        Colour* out2 = out1 + dstPitch;
+
+        for (int x = 0; x < (int)w; x++) {
+            Colour a = above[x - 1], b = above[x], c = above[x + 1];
+            Colour d = row[x - 1],   e = row[x],   f = row[x + 1];
+            Colour g = below[x - 1], h = below[x], i = below[x + 1];
+
+            Colour* o0 = out0 + x * 3;
+            Colour* o1 = out1 + x * 3;
+            Colour* o2 = out2 + x * 3;
+
+            if (b != h && d != f) {
+                o0[0] = d == b ? d : e;
+                o0[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+                o0[2] = b == f ? f : e;
+                o1[0] = (d == b && e != g) || (d == h && e != a) ? d : e;
+                o1[1] = e;
+                o1[2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+                o2[0] = d == h ? d : e;
+                o2[1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+                o2[2] = h == f ? f : e;
+            } else {
+                std::fill(o0, o0 + 3, e);
+                std::fill(o1, o1 + 3, e);
+                std::fill(o2, o2 + 3, e);
+            }
+        }
+    }
+}
+
+void Scaler::scaleXbr(Framebuffer& src, Colour* dst, unsigned int dstPitch, unsigned int firstRow, unsigned int rows) {
+    // scalar, xBR's per-pixel branching doesn't map well onto SIMD
+    unsigned int w = src.getWidth();
+    unsigned int stride = w + SCALER_PAD * 2;
+
+    // source rows y-2 to y+2, row r always in slot r % 5 so each one is loaded once
+    std::vector<Colour> buffer(stride * 5);
+    std::vector<Yuv> yuvBuffer(stride * 5);
+
+    auto load = [&](unsigned int r) { // r is offset by 2, it can't go negative
+        unsigned int slot = r % 5 * stride;
+        loadRow(src, (int)r - 2, buffer.data() + slot + SCALER_PAD);
+
+        for (unsigned int x = 0; x < stride; x++) {
+            yuvBuffer[slot + x] = toYuv(buffer[slot + x]);
+        }
+    };
+
+    for (unsigned int r = firstRow; r < firstRow + 4; r++) load(r);
+
+    const Colour* rowPtrs[5];
+    const Yuv* yuvPtrs[5];
+    Colour block[16];
+
+    for (unsigned int y = firstRow; y < firstRow + rows; y++) {
+        load(y + 4);
+
+        for (int i = 0; i < 5; i++) {
+            unsigned int slot = (y + i) % 5 * stride + SCALER_PAD;
+            rowPtrs[i] = buffer.data() + slot;
+            yuvPtrs[i] = yuvBuffer.data() + slot;
+        }
+
+        for (unsigned int x = 0; x < w; x++) {
+            xbrPixel(rowPtrs + 2, yuvPtrs + 2, x, factor, block);
+
+            for (unsigned int by = 0; by < factor; by++) {
+                memcpy(dst + (y * factor + by) * dstPitch + x * factor, block + by * factor, factor * sizeof(Colour));
+            }
+        }
+    }
+}
+
+} // namespace GB2040::Core
\ No newline at end of file
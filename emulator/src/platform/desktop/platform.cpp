@@ -3,11 +3,19 @@
 #include "core/graphics.h"
 #include "core/audio.h"
 #include "core/console.h"
+#include "core/scaler.h"
 
 #include <cstdint>
 #include <string>
 #include <array>
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
 #include <stdio.h>
 #include <SDL3/SDL.h>
 
@@ -29,6 +37,10 @@ public:
     size_t size(void) {
         return rom.size();
     }
+
+    uint8_t* data(void) override {
+        return rom.data();
+    }
 private:
     std::vector<uint8_t> rom;
 };
@@ -47,6 +59,10 @@ public:
         return sram.size();
     }
 
+    uint8_t* data(void) override {
+        return sram.data();
+    }
+
     void write8(uint32_t addr, uint8_t* buffer, size_t size) {
         memcpy(sram.data() + addr, buffer, size);
     }
@@ -63,6 +79,9 @@ public:
         this->argc = argc;
         this->argv = argv;
 
+        parseOptions();
+        parseScaler();
+
         printf("SDL v%d\n", SDL_GetVersion());
 
         if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS)) {
@@ -70,7 +89,10 @@ public:
             exit(1);
         }
 
-        window = SDL_CreateWindow("gb2040", 480, 432, SDL_WINDOW_RESIZABLE);
+        unsigned int factor = scaler ? scaler->getFactor() : 1;
+        unsigned int windowScale = std::max(factor, 3u);
+
+        window = SDL_CreateWindow("gb2040", GB_WIDTH * windowScale, GB_HEIGHT * windowScale, SDL_WINDOW_RESIZABLE);
         if (!window) {
             printf("Error initialising SDL: %s", SDL_GetError());
             exit(1);
@@ -82,27 +104,37 @@ public:
             exit(1);
         }
 
-        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB565, SDL_TEXTUREACCESS_STREAMING, GB_WIDTH, GB_HEIGHT);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB565, SDL_TEXTUREACCESS_STREAMING, GB_WIDTH * factor, GB_HEIGHT * factor);
 
         if (!texture) {
             printf("Error initialising SDL: %s", SDL_GetError());
             exit(1);
         }
 
-        SDL_SetRenderLogicalPresentation(renderer, 160, 144, SDL_RendererLogicalPresentation::SDL_LOGICAL_PRESENTATION_INTEGER_SCALE);
+        SDL_SetRenderLogicalPresentation(renderer, GB_WIDTH * factor, GB_HEIGHT * factor,
+            factor == 1 ? SDL_LOGICAL_PRESENTATION_INTEGER_SCALE : SDL_LOGICAL_PRESENTATION_LETTERBOX);
+
+        startScaleWorkers();
         SDL_SetTextureScaleMode(texture, SDL_ScaleMode::SDL_SCALEMODE_NEAREST);
+        SDL_SetRenderVSync(renderer, 1); // only ever stalls the presenting thread
 
         // set up audio
         SDL_AudioSpec want {  };
         want.freq = 44100;
-        want.format = SDL_AUDIO_U8;
+        want.format = SDL_AUDIO_S16;
         want.channels = 2;
 
+        // a device buffer well inside the target latency, or it alone would eat most of it
+        SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, std::to_string(std::max<size_t>(audioTarget / 4, 64)).c_str());
+
+        // the device pulls from the sample ring on its own thread, see feedAudio
         audioStream = SDL_OpenAudioDeviceStream(
             SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK,
             &want,
-            NULL,
-            nullptr
+            [](void* self, SDL_AudioStream* stream, int additional, int) {
+                static_cast<DesktopPlatform*>(self)->feedAudio(stream, additional / sizeof(GB2040::Core::StereoSample));
+            },
+            this
         );
 
         if (!audioStream) {
@@ -123,7 +155,17 @@ public:
         RAMROM* romSource = selectROM();
 
         Console* console = new Console(this, romSource);
-        console->run();
+        console->ppu.setRenderInterval(renderInterval);
+
+        // SDL wants rendering and events on the main thread, so the emulator gets its own
+        std::thread emulation([console] { console->run(); });
+
+        while (!quitRequested) {
+            pumpEvents();
+            if (!present()) SDL_DelayNS(1000000); // nothing new yet
+        }
+
+        emulation.join();
 
         console->save();
 
@@ -131,6 +173,8 @@ public:
     }
 
     void deinit(void) override {
+        stopScaleWorkers();
+
         if (texture) SDL_DestroyTexture(texture);
         if (renderer) SDL_DestroyRenderer(renderer);
         if (window) SDL_DestroyWindow(window);
@@ -142,12 +186,13 @@ public:
         SDL_DelayNS(us * 1000);
     }
 
-    bool doEvents(GB2040::Core::Console& console) override {
+    void pumpEvents(void) {
+        // main thread, button changes are queued for the emulator to pick up in doEvents
         SDL_Event e;
 
         while (SDL_PollEvent(&e)) {
             switch (e.type) {
-                case SDL_EVENT_QUIT: return false;
+                case SDL_EVENT_QUIT: quitRequested = true; break;
                 case SDL_EVENT_KEY_DOWN: {
                     using GB2040::Core::Button;
 
@@ -162,14 +207,14 @@ public:
                             audioEnabled = !audioEnabled;
                             SDL_SetAudioStreamGain(audioStream, audioEnabled ? 1.0f : 0.0f);
                             break;
-                        case SDLK_Z: console.pressButton(Button::A); break;
-                        case SDLK_X: console.pressButton(Button::B); break;
-                        case SDLK_RETURN: console.pressButton(Button::START); break;
-                        case SDLK_SPACE: console.pressButton(Button::SELECT); break;
-                        case SDLK_UP: console.pressButton(Button::UP); break;
-                        case SDLK_DOWN: console.pressButton(Button::DOWN); break;
-                        case SDLK_LEFT: console.pressButton(Button::LEFT); break;
-                        case SDLK_RIGHT: console.pressButton(Button::RIGHT); break;
+                        case SDLK_Z: queueInput(Button::A, true); break;
+                        case SDLK_X: queueInput(Button::B, true); break;
+                        case SDLK_RETURN: queueInput(Button::START, true); break;
+                        case SDLK_SPACE: queueInput(Button::SELECT, true); break;
+                        case SDLK_UP: queueInput(Button::UP, true); break;
+                        case SDLK_DOWN: queueInput(Button::DOWN, true); break;
+                        case SDLK_LEFT: queueInput(Button::LEFT, true); break;
+                        case SDLK_RIGHT: queueInput(Button::RIGHT, true); break;
                     }
                     break;
                 } case SDL_EVENT_KEY_UP: {
@@ -178,42 +223,104 @@ public:
                     SDL_Keycode key = e.key.key;
                     
                     switch (key) {
-                        case SDLK_Z: console.releaseButton(Button::A); break;
-                        case SDLK_X: console.releaseButton(Button::B); break;
-                        case SDLK_RETURN: console.releaseButton(Button::START); break;
-                        case SDLK_SPACE: console.releaseButton(Button::SELECT); break;
-                        case SDLK_UP: console.releaseButton(Button::UP); break;
-                        case SDLK_DOWN: console.releaseButton(Button::DOWN); break;
-                        case SDLK_LEFT: console.releaseButton(Button::LEFT); break;
-                        case SDLK_RIGHT: console.releaseButton(Button::RIGHT); break;
+                        case SDLK_Z: queueInput(Button::A, false); break;
+                        case SDLK_X: queueInput(Button::B, false); break;
+                        case SDLK_RETURN: queueInput(Button::START, false); break;
+                        case SDLK_SPACE: queueInput(Button::SELECT, false); break;
+                        case SDLK_UP: queueInput(Button::UP, false); break;
+                        case SDLK_DOWN: queueInput(Button::DOWN, false); break;
+                        case SDLK_LEFT: queueInput(Button::LEFT, false); break;
+                        case SDLK_RIGHT: queueInput(Button::RIGHT, false); break;
                     }
                     break;
                 }
             }
         }
+    }
+
+    void queueInput(GB2040::Core::Button button, bool pressed) {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        inputQueue.push_back({ button, pressed });
+    }
+
+    bool doEvents(GB2040::Core::Console& console) override {
+        // emulator thread, once per frame
+        std::lock_guard<std::mutex> lock(inputMutex);
+
+        for (const InputEvent& input : inputQueue) {
+            if (input.pressed) console.pressButton(input.button);
+            else console.releaseButton(input.button);
+        }
+        inputQueue.clear();
+
+        if (!audioSync) adjustAudioRate(console);
+
+        return !quitRequested;
+    }
+
+    void adjustAudioRate(GB2040::Core::Console& console) {
+        // the wall clock and the sound card's clock never quite agree, so the APU's output rate is
+        // nudged (by a fraction of a percent, far too little to hear) to hold the ring at the target
+        audioFill += (queuedSamples() - audioFill) / 16.0; // smooth out the device's chunky reads
+
+        // proportional for quick response, integral so a steady clock mismatch doesn't leave the level off target
+        double error = std::clamp((audioFill - audioSetPoint) / audioTarget, -1.0, 1.0);
+        audioRateIntegral = std::clamp(audioRateIntegral + error * AUDIO_RATE_INTEGRAL, -AUDIO_MAX_RATE_ADJUST, AUDIO_MAX_RATE_ADJUST);
+
+        double adjust = std::clamp(error * AUDIO_MAX_RATE_ADJUST + audioRateIntegral, -AUDIO_MAX_RATE_ADJUST, AUDIO_MAX_RATE_ADJUST);
+        console.apu.setSampleRate(std::lround(SAMPLE_RATE * (1.0 - adjust)));
+    }
+
+    bool waitForAudio(void) override {
+        if (!audioSync) return false;
+
+        // emulator thread, sleep until the device has played the ring down to the target
+        // (giving up after a while in case it's stalled, so the emulator can't hang)
+        uint64_t deadline = getClock() + 100000;
+        while (queuedSamples() > audioTarget && !quitRequested && getClock() < deadline) SDL_DelayNS(500000);
 
         return true;
     }
 
+    size_t queuedSamples(void) {
+        return audioHead.load(std::memory_order_acquire) - audioTail.load(std::memory_order_acquire);
+    }
+
     uint64_t getClock(void) {
         using namespace std::chrono;
         return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
     }
 
     void draw(void) override {
-        std::swap(front, back);
+        // emulator thread, publish the finished frame and carry on with whichever buffer the presenter isn't using
+        uint8_t prev = readyBuffer.exchange(backIdx | FRAME_FRESH, std::memory_order_acq_rel);
+        backIdx = prev & FRAME_INDEX;
+        back = buffers[backIdx];
+    }
+
+    bool present(void) {
+        // main thread, false if no frame has come in since the last one
+        if (!(readyBuffer.load(std::memory_order_acquire) & FRAME_FRESH)) return false;
+
+        uint8_t prev = readyBuffer.exchange(frontIdx, std::memory_order_acq_rel);
+        frontIdx = prev & FRAME_INDEX;
+        front = buffers[frontIdx];
 
         void* texPixels;
         int pitch;
         SDL_LockTexture(texture, NULL, &texPixels, &pitch);
 
         GB2040::Core::Colour* dst = (GB2040::Core::Colour*)texPixels;
-        for (int y = 0; y < texture->h; y++) {
+        if (scaler) scaleFrame(dst, pitch / sizeof(GB2040::Core::Colour));
+        else for (int y = 0; y < texture->h; y++) {
             GB2040::Core::Colour* row = dst + y * (pitch / sizeof(GB2040::Core::Colour));
+#ifdef INDEXED_FRAMEBUFFER
             for (int x = 0; x < texture->w; x++) {
-                GB2040::Core::Colour pixelLE = front->getPixel(x, y);
-                row[x] = (pixelLE << 8) | (pixelLE >> 8);
+                row[x] = front->getPixel(x, y); // shades only become colours on the way out
             }
+#else
+            memcpy(row, front->getRow(y), GB_WIDTH * sizeof(GB2040::Core::Colour));
+#endif
         }
 
         SDL_UnlockTexture(texture);
@@ -221,6 +328,132 @@ public:
         SDL_RenderClear(renderer);
         SDL_RenderTexture(renderer, texture, NULL, NULL);
         SDL_RenderPresent(renderer);
+
+        return true;
+    }
+
+    void parseOptions(void) {
+        // gb2040 <rom> [filter] [factor] [--latency <ms>] [--audio-sync] [--frameskip <n>] [--no-video]
+        unsigned int latency = AUDIO_DEFAULT_LATENCY;
+
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+
+            if (arg == "--latency" && i + 1 < argc) latency = atoi(argv[++i]);
+            else if (arg == "--audio-sync") audioSync = true;
+            else if (arg == "--frameskip" && i + 1 < argc) renderInterval = std::max(atoi(argv[++i]), 0) + 1;
+            else if (arg == "--no-video") renderInterval = 0;
+            else if (arg.rfind("--", 0) == 0) {
+                printf("Error: unknown option %s\n", arg.c_str());
+                exit(1);
+            } else scalerArgs.push_back(arg);
+        }
+
+        if (latency < AUDIO_MIN_LATENCY || latency > AUDIO_MAX_LATENCY) {
+            printf("Error: latency must be between %u and %u ms\n", AUDIO_MIN_LATENCY, AUDIO_MAX_LATENCY);
+            exit(1);
+        }
+
+        audioTarget = SAMPLE_RATE * latency / 1000;
+
+        // the level is read just after a frame's samples go in, half a frame above its average
+        audioSetPoint = audioTarget + (double)SAMPLE_RATE * CYCLES_PER_FRAME / GB_CLOCK_SPEED / 2;
+        audioFill = audioSetPoint;
+    }
+
+    void parseScaler(void) {
+        // gb2040 <rom> [nearest|scale2x|scale3x|xbr] [factor]
+        if (scalerArgs.empty()) return;
+
+        std::string name = scalerArgs[0];
+        unsigned int factor = scalerArgs.size() > 1 ? atoi(scalerArgs[1].c_str()) : 0;
+
+        GB2040::Core::ScaleFilter filter;
+        if (name == "nearest") filter = GB2040::Core::ScaleFilter::NEAREST;
+        else if (name == "scale2x") filter = GB2040::Core::ScaleFilter::SCALE2X;
+        else if (name == "scale3x") filter = GB2040::Core::ScaleFilter::SCALE3X;
+        else if (name == "xbr") filter = GB2040::Core::ScaleFilter::XBR;
+        else {
+            printf("Error: unknown filter %s (nearest, scale2x, scale3x or xbr)\n", name.c_str());
+            exit(1);
+        }
+
+        if (!factor) factor = filter == GB2040::Core::ScaleFilter::SCALE3X ? 3 : 2;
+
+        if (!GB2040::Core::Scaler::supports(filter, factor)) {
+            printf("Error: %s can't scale by %u\n", name.c_str(), factor);
+            exit(1);
+        }
+
+        if (filter == GB2040::Core::ScaleFilter::NEAREST && factor == 1) return; // same as no scaler
+
+        scaler = new GB2040::Core::Scaler(filter, factor);
+    }
+
+    void startScaleWorkers(void) {
+        // the emulator and the presenter have a core each, the scaler gets what's left (up to 4 more)
+        if (!scaler) return;
+
+        unsigned int cores = std::thread::hardware_concurrency();
+        unsigned int workers = std::min(cores > 3 ? cores - 3 : 0, 4u);
+
+        for (unsigned int i = 0; i < workers; i++) {
+            scaleWorkers.emplace_back([this, i] { scaleWorker(i + 1); });
+        }
+    }
+
+    void stopScaleWorkers(void) {
+        {
+            std::lock_guard<std::mutex> lock(scaleMutex);
+            scaleQuit = true;
+        }
+        scaleStart.notify_all();
+
+        for (std::thread& worker : scaleWorkers) worker.join();
+        scaleWorkers.clear();
+    }
+
+    void scaleWorker(unsigned int band) {
+        uint32_t seen = 0;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(scaleMutex);
+                scaleStart.wait(lock, [&] { return scaleQuit || scaleJob != seen; });
+                if (scaleQuit) return;
+                seen = scaleJob;
+            }
+
+            scaleBand(band);
+
+            std::lock_guard<std::mutex> lock(scaleMutex);
+            if (--scaleBandsLeft == 0) scaleDone.notify_one();
+        }
+    }
+
+    void scaleFrame(GB2040::Core::Colour* dst, unsigned int pitch) {
+        // main thread, splits the front buffer into horizontal bands, one per worker plus its own
+        {
+            std::lock_guard<std::mutex> lock(scaleMutex);
+            scaleDst = dst;
+            scalePitch = pitch;
+            scaleBandsLeft = scaleWorkers.size();
+            scaleJob++;
+        }
+        scaleStart.notify_all();
+
+        scaleBand(0);
+
+        std::unique_lock<std::mutex> lock(scaleMutex);
+        scaleDone.wait(lock, [&] { return scaleBandsLeft == 0; });
+    }
+
+    void scaleBand(unsigned int band) {
+        unsigned int bands = scaleWorkers.size() + 1;
+        unsigned int first = GB_HEIGHT * band / bands;
+        unsigned int last = GB_HEIGHT * (band + 1) / bands;
+
+        scaler->scale(*front, scaleDst, scalePitch, first, last - first);
     }
 
     RAMROM* selectROM(void) override {
@@ -282,15 +515,47 @@ public:
     }
 
     void pushSamples(GB2040::Core::StereoSample* samples, size_t count) override {
-        int queued = SDL_GetAudioStreamAvailable(audioStream) / sizeof(GB2040::Core::StereoSample);
+        // emulator thread: no locks or allocations, just copy in and publish
+        size_t head = audioHead.load(std::memory_order_relaxed);
+        size_t tail = audioTail.load(std::memory_order_acquire);
 
-        if (queued < SAMPLE_RATE / 10) {
-            size_t padCount = (SAMPLE_RATE / 10) - queued;
-            std::vector<GB2040::Core::StereoSample> silence(padCount, { 128, 128 });
-            SDL_PutAudioStreamData(audioStream, silence.data(), padCount * sizeof(GB2040::Core::StereoSample));
-        }
+        count = std::min(count, AUDIO_RING_SIZE - (head - tail)); // running ahead of the device, drop the excess
+
+        size_t start = head % AUDIO_RING_SIZE;
+        size_t first = std::min(count, AUDIO_RING_SIZE - start);
+        memcpy(&audioRing[start], samples, first * sizeof(GB2040::Core::StereoSample));
+        memcpy(&audioRing[0], samples + first, (count - first) * sizeof(GB2040::Core::StereoSample));
+
+        audioHead.store(head + count, std::memory_order_release);
+    }
+
+    void feedAudio(SDL_AudioStream* stream, size_t wanted) {
+        // audio thread: hand over whatever the ring holds, silence for the rest
+        size_t tail = audioTail.load(std::memory_order_relaxed);
+        size_t queued = audioHead.load(std::memory_order_acquire) - tail;
+
+        // after an underrun, let a little build up again rather than crackling along empty
+        if (!audioPrimed && queued >= audioTarget) audioPrimed = true;
+
+        size_t count = audioPrimed ? std::min(wanted, queued) : 0;
 
-        SDL_PutAudioStreamData(audioStream, samples, count * sizeof(GB2040::Core::StereoSample));
+        size_t start = tail % AUDIO_RING_SIZE;
+        size_t first = std::min(count, AUDIO_RING_SIZE - start);
+        if (first) SDL_PutAudioStreamData(stream, &audioRing[start], first * sizeof(GB2040::Core::StereoSample));
+        if (count > first) SDL_PutAudioStreamData(stream, &audioRing[0], (count - first) * sizeof(GB2040::Core::StereoSample));
+
+        audioTail.store(tail + count, std::memory_order_release);
+
+        if (count < wanted) {
+            audioPrimed = false;
+
+            static const GB2040::Core::StereoSample silence[256] {};
+            for (size_t left = wanted - count; left > 0;) {
+                size_t n = std::min(left, std::size(silence));
+                SDL_PutAudioStreamData(stream, silence, n * sizeof(GB2040::Core::StereoSample));
+                left -= n;
+            }
+        }
     }
 
 private:
@@ -306,6 +571,67 @@ private:
 
     bool fullscreen = false;
     bool audioEnabled = true;
+
+    std::atomic<bool> quitRequested = false;
+
+    struct InputEvent {
+        GB2040::Core::Button button;
+        bool pressed;
+    };
+
+    std::mutex inputMutex;
+    std::vector<InputEvent> inputQueue;
+
+    // single producer (emulator) single consumer (audio device) sample ring, head and tail only ever grow
+    static constexpr size_t AUDIO_RING_SIZE = 8192;
+
+    GB2040::Core::StereoSample audioRing[AUDIO_RING_SIZE];
+    std::atomic<size_t> audioHead = 0;
+    std::atomic<size_t> audioTail = 0;
+    bool audioPrimed = false; // audio thread only
+
+    // how full the ring is kept, which is most of the output latency
+    static constexpr unsigned int AUDIO_DEFAULT_LATENCY = 40; // ms
+    static constexpr unsigned int AUDIO_MIN_LATENCY = 10;
+    static constexpr unsigned int AUDIO_MAX_LATENCY = 150; // well inside the ring
+    static constexpr double AUDIO_MAX_RATE_ADJUST = 0.005;
+    static constexpr double AUDIO_RATE_INTEGRAL = 0.00005; // per frame
+
+    size_t audioTarget = 0; // samples
+    double audioSetPoint = 0.0; // what the ring should read right after a frame is pushed
+    double audioFill = 0.0; // smoothed ring level, emulator thread only
+    double audioRateIntegral = 0.0;
+    bool audioSync = false; // pace frames off the audio device rather than the wall clock
+
+    std::vector<std::string> scalerArgs;
+
+    uint32_t renderInterval = 1; // draw every Nth frame, 0 for none
+
+    // triple buffering, the emulator owns back, the presenter owns front and the
+    // last finished frame waits in between (its index plus FRAME_FRESH until taken)
+    static constexpr uint8_t FRAME_INDEX = 0x03;
+    static constexpr uint8_t FRAME_FRESH = 0x04;
+
+    GB2040::Core::Framebuffer fbC { GB_WIDTH, GB_HEIGHT };
+    GB2040::Core::Framebuffer* buffers[3] = { &fbA, &fbB, &fbC };
+
+    uint8_t backIdx = 0; // fbA, the base class starts back there
+    uint8_t frontIdx = 1;
+    std::atomic<uint8_t> readyBuffer = 2;
+
+    // optional upscaling on the way to the texture, spread over a few worker threads
+    GB2040::Core::Scaler* scaler = nullptr;
+
+    std::vector<std::thread> scaleWorkers;
+    std::mutex scaleMutex;
+    std::condition_variable scaleStart;
+    std::condition_variable scaleDone;
+    uint32_t scaleJob = 0; // bumped for every frame
+    unsigned int scaleBandsLeft = 0;
+    bool scaleQuit = false;
+
+    GB2040::Core::Colour* scaleDst = nullptr;
+    unsigned int scalePitch = 0;
 };
 
 Platform* createPlatform(void) {